@@ -2,6 +2,18 @@
 #include <cpu/registers.h>
 #include <cpu/disassembler.h>
 
+// What the stepping thread's last run() stopped on, a budget means it was paused from the UI
+static const char *exit_reason_name(ExitReason reason) {
+	switch (reason) {
+		case ExitReason::BudgetExhausted: return "Paused";
+		case ExitReason::Breakpoint: return "Breakpoint";
+		case ExitReason::Trap: return "Trap";
+		case ExitReason::Halt: return "Halted";
+		case ExitReason::Error: return "Error";
+	}
+	return "Unknown";
+}
+
 void ImGui_Risky::imgui_registers_window_32(Core *core, bool *debug_window) {
 	ImGui::Begin("CPU Registers", debug_window);
 	ImGui::Text("General-Purpose Registers:");
@@ -150,6 +162,12 @@ void ImGui_Risky::imgui_disassembly_window_32(Core *core) {
 
 	ImGui::Combo("Register Names", &selectedRegisterNames, registerNameSets, IM_ARRAYSIZE(registerNameSets));
 
+	if (core->thread_running()) {
+		ImGui::Text("Running");
+	} else {
+		ImGui::Text("Stopped: %s", exit_reason_name(core->last_exit_reason()));
+	}
+
 	ImGui::BeginChild("Disassembly", ImVec2(0, 0), true);
 
 	int numInstructions = ImGui::GetWindowHeight() / ImGui::GetTextLineHeight();
@@ -9,6 +9,7 @@
 #include <cpu/core/rv32/rv32i.h>
 #include <cpu/core/rv64/rv64i.h>
 #include <cpu/core/core.h>
+#include <algorithm>
 #include <cstdio>
 #include <SDL3/SDL.h>
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -93,6 +94,7 @@ void ImGui_Risky::run() {
 	bool cpu_reg_debug_window = false;
 	bool disassembly_window = false;
 	bool llvm_ir_blocks_window = false;
+	bool fusion_stats_window = false;
 	IGFD::FileDialogConfig config; config.path = ".";
 
 	// 0: RV32I, 1: RV32E, 2: RV64I
@@ -112,6 +114,12 @@ void ImGui_Risky::run() {
     symbols_loaded = false;
     Core core;
     EmulationType selected_emulation_type = EmulationType::Interpreter;
+    int tier_compile_threshold = 64;
+    int tier_optimize_threshold = 4096;
+    // 0 keeps the backend's default, otherwise the LLVM level is one less
+    int jit_opt_level = 0;
+    // 0 keeps the backend's default of one per spare host core
+    int jit_compile_workers = 0;
 
 #ifdef __EMSCRIPTEN__
 	// For an Emscripten build we are disabling file-system access, so let's not attempt to do a fopen() of the imgui.ini file.
@@ -227,6 +235,7 @@ void ImGui_Risky::run() {
 				static bool menu_toggle_log_window = true;
 				static bool menu_toggle_disassembler_window = false;
 				static bool menu_toggle_llvm_ir_blocks_window = false;
+				static bool menu_toggle_fusion_stats_window = false;
 
                 ImGui::MenuItem("Log", "", &menu_toggle_log_window, true);
 
@@ -235,10 +244,14 @@ void ImGui_Risky::run() {
                     ImGui::MenuItem("CPU Registers", "", &menu_toggle_cpu_reg_window, true);
                     ImGui::MenuItem("Disassembler", "", &menu_toggle_disassembler_window, true);
                 
-					if (core.get_emulation_type() == EmulationType::JIT)
+					if (core.get_emulation_type() == EmulationType::JIT || core.get_emulation_type() == EmulationType::Tiered)
 					{
 						ImGui::MenuItem("LLVM IR Blocks", "", &menu_toggle_llvm_ir_blocks_window, true);
 					}
+					else
+					{
+						ImGui::MenuItem("Fusion Stats", "", &menu_toggle_fusion_stats_window, true);
+					}
 				}
 
 				if (menu_toggle_cpu_reg_window)
@@ -277,6 +290,15 @@ void ImGui_Risky::run() {
                     llvm_ir_blocks_window = false;
                 }
 
+				if (menu_toggle_fusion_stats_window)
+				{
+					fusion_stats_window = true;
+				}
+				else
+				{
+					fusion_stats_window = false;
+				}
+
 				ImGui::EndMenu();
 			}
 
@@ -341,6 +363,10 @@ void ImGui_Risky::run() {
 			imgui_llvm_ir_blocks_window(&core);
         }
 
+		if (fusion_stats_window) {
+			imgui_fusion_stats_window(&core);
+		}
+
 		if (cpu_reg_debug_window)
 		{
             if (core.get_xlen() == 32)
@@ -415,6 +441,26 @@ void ImGui_Risky::run() {
             ImGui::RadioButton("Interpreter", reinterpret_cast<int*>(&selected_emulation_type), static_cast<int>(EmulationType::Interpreter));
             ImGui::SameLine();
             ImGui::RadioButton("Recompiler (LLVM)", reinterpret_cast<int*>(&selected_emulation_type), static_cast<int>(EmulationType::JIT));
+            ImGui::SameLine();
+            ImGui::RadioButton("Threaded Interpreter", reinterpret_cast<int*>(&selected_emulation_type), static_cast<int>(EmulationType::Threaded));
+            ImGui::SameLine();
+            ImGui::RadioButton("Tiered", reinterpret_cast<int*>(&selected_emulation_type), static_cast<int>(EmulationType::Tiered));
+
+            if (selected_emulation_type == EmulationType::Tiered)
+            {
+                ImGui::InputInt("Compile after N entries", &tier_compile_threshold);
+                ImGui::InputInt("Optimize after N runs (0 = off)", &tier_optimize_threshold);
+                tier_compile_threshold = std::max(tier_compile_threshold, 1);
+                tier_optimize_threshold = std::max(tier_optimize_threshold, 0);
+            }
+
+            if (selected_emulation_type == EmulationType::JIT || selected_emulation_type == EmulationType::Tiered)
+            {
+                static const char* optLevelNames[] = { "Default", "O0", "O1", "O2", "O3" };
+                ImGui::Combo("LLVM Optimization", &jit_opt_level, optLevelNames, IM_ARRAYSIZE(optLevelNames));
+                ImGui::InputInt("Compile threads (0 = default)", &jit_compile_workers);
+                jit_compile_workers = std::max(jit_compile_workers, 0);
+            }
 
 			if (core_.empty())
 			{
@@ -469,6 +515,19 @@ void ImGui_Risky::run() {
 							break;
 					}
 
+                    if (built_core && riscv_core_32)
+                    {
+                        if (auto* jit = dynamic_cast<JITBackend*>(riscv_core_32->get_backend()))
+                        {
+                            if (selected_emulation_type == EmulationType::Tiered)
+                                jit->set_tier_thresholds(tier_compile_threshold, tier_optimize_threshold);
+                            if (jit_opt_level > 0)
+                                jit->set_opt_level(jit_opt_level - 1);
+                            if (jit_compile_workers > 0)
+                                jit->set_compile_workers(jit_compile_workers);
+                        }
+                    }
+
                     if (built_core)
                     {
                         Logger::info("Built " + core_ + " core (XLEN: " + xlen_ + ")");
@@ -574,18 +633,22 @@ void ImGui_Risky::imgui_llvm_ir_blocks_window(Core *core) {
     }
 
     if (jit_backend_ptr) {
-        const auto& block_cache = jit_backend_ptr->get_block_cache();
-
-        for (const auto& block : block_cache) {
-            if (ImGui::TreeNode((void*)(intptr_t)block.first, "Block at PC: 0x%08X", block.first)) {
-                ImGui::Text("Start PC: 0x%08X", block.second.start_pc);
-                ImGui::Text("End PC: 0x%08X", block.second.end_pc);
-                ImGui::Text("Contains Branch: %s", block.second.contains_branch ? "Yes" : "No");
-                ImGui::Text("Last Used: %llu", block.second.last_used);
-                ImGui::Text("Code Pointer: %p", block.second.code_ptr);
+        for (const auto& block : jit_backend_ptr->get_compiled_blocks()) {
+            if (ImGui::TreeNode((void*)(intptr_t)block.start_pc, "Block at PC: 0x%08X", block.start_pc)) {
+                ImGui::Text("Start PC: 0x%08X", block.start_pc);
+                ImGui::Text("End PC: 0x%08X", block.end_pc);
+                ImGui::Text("Contains Branch: %s", block.contains_branch ? "Yes" : "No");
+                ImGui::Text("Tier: %u", static_cast<unsigned>(block.tier));
+                ImGui::Text("Trace Blocks: %u", block.trace_blocks);
+                ImGui::Text("Executions: %llu", static_cast<unsigned long long>(block.executions));
+                ImGui::Text("Last Used: %llu", static_cast<unsigned long long>(block.last_used));
+                ImGui::Text("Code Size: %zu bytes", block.code_size);
+                ImGui::Text("Compiled at O%u in %.3f ms%s", static_cast<unsigned>(block.opt_level), block.compile_time_us / 1000.0,
+                            block.from_cache ? " (object cache)" : "");
+                ImGui::Text("Code Pointer: %p", block.code_ptr);
                 ImGui::Separator();
                 ImGui::Text("LLVM IR:");
-                ImGui::TextWrapped("%s", block.second.llvm_ir.c_str());
+                ImGui::TextWrapped("%s", block.llvm_ir ? block.llvm_ir->c_str() : "");
                 ImGui::TreePop();
             }
         }
@@ -594,4 +657,40 @@ void ImGui_Risky::imgui_llvm_ir_blocks_window(Core *core) {
     }
 
     ImGui::End();
-}
\ No newline at end of file
+}
+
+void ImGui_Risky::imgui_fusion_stats_window(Core *core) {
+    ImGui::Begin("Fusion Stats");
+
+    InterpreterBackend* interpreter_ptr = nullptr;
+
+    if (riscv_core_32) {
+        interpreter_ptr = dynamic_cast<InterpreterBackend*>(riscv_core_32->get_backend());
+    } else if (riscv_core_32e) {
+        interpreter_ptr = dynamic_cast<InterpreterBackend*>(riscv_core_32e->get_backend());
+    } else if (riscv_core_64) {
+        interpreter_ptr = dynamic_cast<InterpreterBackend*>(riscv_core_64->get_backend());
+    }
+
+    if (interpreter_ptr) {
+        if (ImGui::BeginTable("fusion_stats", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Pair");
+            ImGui::TableSetupColumn("Executed");
+            ImGui::TableHeadersRow();
+
+            for (const auto& [name, count] : interpreter_ptr->get_fusion_stats()) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%llu", static_cast<unsigned long long>(count));
+            }
+
+            ImGui::EndTable();
+        }
+    } else {
+        ImGui::Text("No interpreter backend available.");
+    }
+
+    ImGui::End();
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include "risky.h"
 #include <log/log.hh>
 
@@ -11,6 +12,17 @@
 #define UART_THR                    (UART + 0x00)
 #define UART_LSR                    (UART + 0x05)
 
+#define RAM_BASE                    0x80000000
+#define CODE_PAGE_SHIFT             12
+#define CODE_PAGE_SIZE              (1 << CODE_PAGE_SHIFT)
+
+// Notified when a store hits a RAM page some backend has cached code for
+class CodeWriteObserver {
+public:
+	virtual ~CodeWriteObserver() = default;
+	virtual void code_written(std::uint32_t address) = 0;
+};
+
 class Bus {
 
 public:
@@ -27,4 +39,30 @@ public:
 	std::uint32_t read32(std::uint32_t address);
 	void write8(uint32_t address, uint8_t value);
 	void write32(uint32_t address, uint32_t value);
+
+	void add_code_observer(CodeWriteObserver* observer);
+	void remove_code_observer(CodeWriteObserver* observer);
+	void mark_code_page(std::uint32_t address);
+	// Every observer drops all the code it holds, for fence.i and whole images copied into RAM
+	void invalidate_code_pages();
+
+	// Host address of the RAM code page holding address, nullptr outside of RAM
+	std::uint8_t* host_page(std::uint32_t address);
+
+	// One flag per RAM page, anything storing to RAM without write8/write32 has to leave flagged pages to them
+	const std::uint8_t* code_page_flags() const { return code_pages.data(); }
+
+private:
+	// One flag per RAM page, set while any observer holds code decoded from it
+	std::vector<std::uint8_t> code_pages;
+	std::vector<CodeWriteObserver*> code_observers;
+
+	void code_page_written(std::size_t offset);
+
+	inline void check_code_write(std::size_t offset, std::size_t size) {
+		if (code_pages[offset >> CODE_PAGE_SHIFT] || code_pages[(offset + size - 1) >> CODE_PAGE_SHIFT]) {
+			code_page_written(offset);
+			code_page_written(offset + size - 1);
+		}
+	}
 };
\ No newline at end of file
@@ -1,8 +1,19 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Why a batched run() handed control back to its caller
+enum class ExitReason {
+    BudgetExhausted,
+    Breakpoint,
+    Trap,
+    Halt,
+    Error
+};
 
 class CompiledBlock {
 public:
@@ -10,14 +21,43 @@ public:
     uint32_t end_pc;
     void* code_ptr;
     uint64_t last_used;
+    // Times the native code has run, drives promotion to the next tier
+    uint64_t executions;
+    // 1 is the quick first compile, 2 is recompiled with the LLVM optimizer
+    uint8_t tier;
+    // Size of the emitted machine code, counted against the JIT's code budget
+    size_t code_size;
+    // LLVM pipeline the block went through (0 is none) and how long IR generation plus codegen took
+    uint8_t opt_level;
+    uint64_t compile_time_us;
+    // Machine code came from the on-disk object cache rather than codegen
+    bool from_cache;
     bool contains_branch;
-    std::string llvm_ir;
+    // Guest blocks compiled into this one, more than 1 when tier 2 followed their hot exits
+    uint32_t trace_blocks;
+    // Never changes once the block is compiled, every copy of the block shares it
+    std::shared_ptr<const std::string> llvm_ir;
 };
 
 class JITBackend {
 public:
     virtual ~JITBackend() = default;
-    virtual const std::unordered_map<uint32_t, CompiledBlock>& get_block_cache() const = 0;
+    // Copies sorted by start PC, the frontend asks every frame while the emulation thread keeps compiling
+    // and evicting blocks. The IR is shared, not copied
+    virtual std::vector<CompiledBlock> get_compiled_blocks() const = 0;
+    // Block entries before a block is compiled, and native runs before it's optimized (0 disables that tier)
+    virtual void set_tier_thresholds(std::uint32_t compile_threshold, std::uint32_t optimize_threshold) = 0;
+    // LLVM optimization level (0 to 3) for new blocks, trades compile latency against code quality
+    virtual void set_opt_level(std::uint8_t level) = 0;
+    // Threads compiling blocks in the background, never fewer than one
+    virtual void set_compile_workers(unsigned count) = 0;
+};
+
+class InterpreterBackend {
+public:
+    virtual ~InterpreterBackend() = default;
+    // How many times each fused instruction pair has executed, by name
+    virtual std::vector<std::pair<std::string, std::uint64_t>> get_fusion_stats() const = 0;
 };
 
 class CoreBackend {
@@ -25,7 +65,7 @@ public:
     virtual ~CoreBackend() = default;
     virtual void execute_opcode(std::uint32_t opcode) = 0;
     virtual void step() = 0;
-    virtual void run() = 0;
+    virtual ExitReason run(std::uint64_t max_instructions) = 0;
 
     bool ready = false;
 };
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <cpu/core/core.h>
+#include <cpu/core/backend.h>
+#include <cpu/riscv.h>
+#include <bus/bus.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Extension sets an interpreter can be specialised for, see create_interpreter()
+namespace InterpreterExtension {
+    constexpr std::uint32_t M = 1 << 0;
+    constexpr std::uint32_t A = 1 << 1;
+    constexpr std::uint32_t Zicsr = 1 << 2;
+    constexpr std::uint32_t Zifencei = 1 << 3;
+    constexpr std::uint32_t All = M | A | Zicsr | Zifencei;
+
+    // The only sets that get a specialisation, smallest first; any other
+    // combination runs on the first one that covers it
+    constexpr std::array<std::uint32_t, 3> Profiles = {Zicsr | Zifencei, M | Zicsr | Zifencei, All};
+}
+
+/*
+ * One interpreter for every RISCV<xlen, is_embedded> core. Register width,
+ * register count and the RV64-only instructions are resolved at compile time.
+ * Instructions from extensions missing in the mask, or compiled in but turned
+ * off on the core, decode straight to their *_unavailable handler, so the hot
+ * path never checks the core's extension flags.
+ */
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+class Interpreter : public CoreBackend, public InterpreterBackend, public CodeWriteObserver {
+public:
+    Interpreter(RISCV<xlen, is_embedded>* core, bool threaded = false);
+    ~Interpreter();
+    void execute_opcode(std::uint32_t opcode) override;
+    void step() override;
+    ExitReason run(std::uint64_t max_instructions) override;
+
+    void code_written(std::uint32_t address) override;
+
+    std::vector<std::pair<std::string, std::uint64_t>> get_fusion_stats() const override;
+
+private:
+    static constexpr bool HAS_M = (extensions & InterpreterExtension::M) != 0;
+    static constexpr bool HAS_A = (extensions & InterpreterExtension::A) != 0;
+    static constexpr bool HAS_ZICSR = (extensions & InterpreterExtension::Zicsr) != 0;
+    static constexpr bool HAS_ZIFENCEI = (extensions & InterpreterExtension::Zifencei) != 0;
+
+    using reg_t = typename RISCV<xlen, is_embedded>::addr_t;
+    using sreg_t = std::make_signed_t<reg_t>;
+    // Wide enough for the high half of an XLEN x XLEN multiply
+    using dreg_t = std::conditional_t<xlen == 32, std::uint64_t, __uint128_t>;
+    using sdreg_t = std::conditional_t<xlen == 32, std::int64_t, __int128_t>;
+
+    static constexpr bool IS_RV64 = xlen == 64;
+    static constexpr std::size_t REGISTER_COUNT = is_embedded ? 16 : 32;
+
+    RISCV<xlen, is_embedded>* core;
+    bool threaded;
+    // Subset of the mask the core actually has, only looked at while decoding
+    std::uint32_t enabled_extensions;
+
+    // Set by handlers that need run() to hand control back (ecall, ebreak, wfi)
+    bool exit_requested = false;
+    ExitReason requested_exit = ExitReason::BudgetExhausted;
+
+    void request_exit(ExitReason reason);
+    ExitReason take_exit_reason();
+
+    struct DecodedInstruction;
+
+    typedef void (Interpreter::*OpcodeHandler)(const DecodedInstruction&);
+
+    // One entry per handler; handler_table and the threaded label table are
+    // both indexed by it, so keep them in this order
+    enum class Op : std::uint8_t {
+        Decode,
+        Illegal,
+        IllegalOp,
+        IllegalAmo,
+        MUnavailable,
+        AUnavailable,
+        ZicsrUnavailable,
+        ZifenceiUnavailable,
+        Auipc,
+        Lui,
+        Jal,
+        Jalr,
+        Lb,
+        Lw,
+        Lbu,
+        Lh,
+        Lhu,
+        Sub,
+        Add,
+        Sll,
+        Sltu,
+        Xor,
+        Or,
+        And,
+        Slt,
+        Srl,
+        Sra,
+        Mul,
+        Mulhu,
+        Div,
+        Mulh,
+        Mulhsu,
+        Divu,
+        Rem,
+        Remu,
+        // Csrrw to Csrrci stay together, see disable_missing_extension()
+        Csrrw,
+        Csrrs,
+        Csrrc,
+        Csrrsi,
+        Csrrwi,
+        Csrrci,
+        FenceI,
+        Fence,
+        Ecall,
+        Ebreak,
+        Wfi,
+        Addi,
+        Slli,
+        Sltiu,
+        Srli,
+        Srai,
+        Andi,
+        Slti,
+        Xori,
+        Ori,
+        Beq,
+        Bne,
+        Blt,
+        Bge,
+        Bltu,
+        Bgeu,
+        Sb,
+        Sw,
+        Sh,
+        AmoorW,
+        AmoaddW,
+        AmoswapW,
+        AmoxorW,
+        AmoandW,
+        AmominW,
+        AmomaxW,
+        AmominuW,
+        AmomaxuW,
+        LrW,
+        ScW,
+        // RV64I only
+        Ld,
+        Lwu,
+        Sd,
+        Addiw,
+        Slliw,
+        Srliw,
+        Sraiw,
+        Addw,
+        Subw,
+        // Fused pairs, see try_fuse()
+        LuiAddi,
+        AuipcJalr,
+        AuipcLw,
+        SltuBnez,
+        SltuBeqz,
+        SltiuBnez,
+        SltiuBeqz,
+        Count
+    };
+
+    static constexpr std::size_t FIRST_FUSED_OP = static_cast<std::size_t>(Op::LuiAddi);
+    static constexpr std::size_t FUSED_OP_COUNT = static_cast<std::size_t>(Op::Count) - FIRST_FUSED_OP;
+
+    // Read by the UI while the core runs. Only the run thread writes them, so
+    // count_fusion() gets away with a relaxed load and store instead of a locked add
+    std::array<std::atomic<std::uint64_t>, FUSED_OP_COUNT> fusion_counts{};
+
+    void count_fusion(Op op);
+
+    // Instruction fields are extracted (and the immediate sign-extended) once,
+    // handlers only ever look at this form
+    struct DecodedInstruction {
+        OpcodeHandler handler;
+        std::int32_t imm;
+        union {
+            std::uint32_t opcode;
+            // Fused pairs don't need the raw encoding, this holds the second immediate
+            std::int32_t fused_imm;
+        };
+        Op op;
+        std::uint8_t rd;
+        std::uint8_t rs1;
+        std::uint8_t rs2;
+    };
+
+    static constexpr std::size_t DECODED_PAGE_ENTRIES = CODE_PAGE_SIZE / 4;
+
+    struct DecodedPage {
+        std::array<DecodedInstruction, DECODED_PAGE_ENTRIES> entries;
+    };
+
+    // Pages are reset in place instead of being freed, a store may invalidate
+    // the page of the instruction that is currently executing
+    std::unordered_map<reg_t, std::unique_ptr<DecodedPage>> decoded_pages;
+    DecodedPage* current_page = nullptr;
+    reg_t current_page_base = ~static_cast<reg_t>(0);
+    DecodedInstruction uncached_instruction;
+
+    DecodedInstruction decode(std::uint32_t opcode) const;
+    static bool uses_missing_register(std::uint32_t opcode);
+    Op disable_missing_extension(Op op, std::uint32_t opcode) const;
+    const DecodedInstruction& fetch_decoded(reg_t pc);
+    void switch_page(reg_t pc);
+    void reset_page(DecodedPage& page);
+    void flush_decoded_pages();
+    const DecodedInstruction& decode_slot(const DecodedInstruction& instruction);
+    void try_fuse(DecodedInstruction& first, reg_t pc);
+    void decode_and_execute(const DecodedInstruction& instruction);
+
+    ExitReason run_threaded(std::uint64_t budget);
+
+    // Primary table is indexed by (opcode[6:0] << 3) | funct3, OP and AMO
+    // resolve the remaining bits through their own funct7/funct5 tables
+    static constexpr std::size_t OPCODE_TABLE_SIZE = 128 * 8;
+    static constexpr std::size_t OP_TABLE_ROWS = 4;
+    static constexpr std::size_t AMO_TABLE_SIZE = 32;
+    static constexpr std::size_t HANDLER_TABLE_SIZE = static_cast<std::size_t>(Op::Count);
+
+    static const std::array<Op, OPCODE_TABLE_SIZE> opcode_table;
+    static const std::array<std::uint8_t, 128> op_funct7_rows;
+    static const std::array<std::array<Op, 8>, OP_TABLE_ROWS> op_table;
+    static const std::array<std::array<Op, 8>, OP_TABLE_ROWS> op32_table;
+    static const std::array<Op, AMO_TABLE_SIZE> amo_table;
+    static const std::array<OpcodeHandler, HANDLER_TABLE_SIZE> handler_table;
+
+    static constexpr std::array<Op, OPCODE_TABLE_SIZE> build_opcode_table();
+    static constexpr std::array<std::array<Op, 8>, OP_TABLE_ROWS> build_op_table();
+    static constexpr std::array<std::array<Op, 8>, OP_TABLE_ROWS> build_op32_table();
+    static constexpr std::array<Op, AMO_TABLE_SIZE> build_amo_table();
+    static constexpr std::array<OpcodeHandler, HANDLER_TABLE_SIZE> build_handler_table();
+
+    void illegal_instruction(const DecodedInstruction& instruction);
+    void illegal_op(const DecodedInstruction& instruction);
+    void illegal_amo(const DecodedInstruction& instruction);
+    void m_unavailable(const DecodedInstruction& instruction);
+    void a_unavailable(const DecodedInstruction& instruction);
+    void zicsr_unavailable(const DecodedInstruction& instruction);
+    void zifencei_unavailable(const DecodedInstruction& instruction);
+
+    void rv32i_caddi(std::uint16_t opcode);
+    void rv32i_auipc(const DecodedInstruction& instruction);
+    void rv32i_lui(const DecodedInstruction& instruction);
+    void rv32i_jal(const DecodedInstruction& instruction);
+    void rv32i_jalr(const DecodedInstruction& instruction);
+    void rv32i_lb(const DecodedInstruction& instruction);
+    void rv32i_lw(const DecodedInstruction& instruction);
+    void rv32i_lbu(const DecodedInstruction& instruction);
+    void rv32i_lh(const DecodedInstruction& instruction);
+    void rv32i_lhu(const DecodedInstruction& instruction);
+    void rv32i_sub(const DecodedInstruction& instruction);
+    void rv32i_add(const DecodedInstruction& instruction);
+    void rv32i_sll(const DecodedInstruction& instruction);
+    void rv32i_sltu(const DecodedInstruction& instruction);
+    void rv32i_xor(const DecodedInstruction& instruction);
+    void rv32i_or(const DecodedInstruction& instruction);
+    void rv32i_and(const DecodedInstruction& instruction);
+    void rv32i_slt(const DecodedInstruction& instruction);
+    void rv32i_srl(const DecodedInstruction& instruction);
+    void rv32i_sra(const DecodedInstruction& instruction);
+    void rv32i_mul(const DecodedInstruction& instruction);
+    void rv32i_mulhu(const DecodedInstruction& instruction);
+    void rv32i_div(const DecodedInstruction& instruction);
+    void rv32i_mulh(const DecodedInstruction& instruction);
+    void rv32i_mulhsu(const DecodedInstruction& instruction);
+    void rv32i_divu(const DecodedInstruction& instruction);
+    void rv32i_rem(const DecodedInstruction& instruction);
+    void rv32i_remu(const DecodedInstruction& instruction);
+    void rv32i_csrrw(const DecodedInstruction& instruction);
+    void rv32i_csrrs(const DecodedInstruction& instruction);
+    void rv32i_csrrc(const DecodedInstruction& instruction);
+    void rv32i_csrrsi(const DecodedInstruction& instruction);
+    void rv32i_csrrwi(const DecodedInstruction& instruction);
+    void rv32i_csrrci(const DecodedInstruction& instruction);
+    void rv32i_fence_i(const DecodedInstruction& instruction);
+    void rv32i_fence(const DecodedInstruction& instruction);
+    void rv32i_ecall(const DecodedInstruction& instruction);
+    void rv32i_ebreak(const DecodedInstruction& instruction);
+    void rv32i_wfi(const DecodedInstruction& instruction);
+    void rv32i_addi(const DecodedInstruction& instruction);
+    void rv32i_slli(const DecodedInstruction& instruction);
+    void rv32i_sltiu(const DecodedInstruction& instruction);
+    void rv32i_srli(const DecodedInstruction& instruction);
+    void rv32i_srai(const DecodedInstruction& instruction);
+    void rv32i_andi(const DecodedInstruction& instruction);
+    void rv32i_slti(const DecodedInstruction& instruction);
+    void rv32i_xori(const DecodedInstruction& instruction);
+    void rv32i_ori(const DecodedInstruction& instruction);
+    void rv32i_beq(const DecodedInstruction& instruction);
+    void rv32i_bne(const DecodedInstruction& instruction);
+    void rv32i_blt(const DecodedInstruction& instruction);
+    void rv32i_bge(const DecodedInstruction& instruction);
+    void rv32i_bltu(const DecodedInstruction& instruction);
+    void rv32i_bgeu(const DecodedInstruction& instruction);
+    void rv32i_sb(const DecodedInstruction& instruction);
+    void rv32i_sw(const DecodedInstruction& instruction);
+    void rv32i_sh(const DecodedInstruction& instruction);
+    void rv32i_amoor_w(const DecodedInstruction& instruction);
+    void rv32i_amoadd_w(const DecodedInstruction& instruction);
+    void rv32i_amoswap_w(const DecodedInstruction& instruction);
+    void rv32i_amoxor_w(const DecodedInstruction& instruction);
+    void rv32i_amoand_w(const DecodedInstruction& instruction);
+    void rv32i_amomin_w(const DecodedInstruction& instruction);
+    void rv32i_amomax_w(const DecodedInstruction& instruction);
+    void rv32i_amominu_w(const DecodedInstruction& instruction);
+    void rv32i_amomaxu_w(const DecodedInstruction& instruction);
+    void rv32i_lr_w(const DecodedInstruction& instruction);
+    void rv32i_sc_w(const DecodedInstruction& instruction);
+    template <typename Combine>
+    void amo_w(const DecodedInstruction& instruction, Combine combine);
+
+    void rv64i_ld(const DecodedInstruction& instruction);
+    void rv64i_lwu(const DecodedInstruction& instruction);
+    void rv64i_sd(const DecodedInstruction& instruction);
+    void rv64i_addiw(const DecodedInstruction& instruction);
+    void rv64i_slliw(const DecodedInstruction& instruction);
+    void rv64i_srliw(const DecodedInstruction& instruction);
+    void rv64i_sraiw(const DecodedInstruction& instruction);
+    void rv64i_addw(const DecodedInstruction& instruction);
+    void rv64i_subw(const DecodedInstruction& instruction);
+
+    void fused_lui_addi(const DecodedInstruction& instruction);
+    void fused_auipc_jalr(const DecodedInstruction& instruction);
+    void fused_auipc_lw(const DecodedInstruction& instruction);
+    void fused_sltu_bnez(const DecodedInstruction& instruction);
+    void fused_sltu_beqz(const DecodedInstruction& instruction);
+    void fused_sltiu_bnez(const DecodedInstruction& instruction);
+    void fused_sltiu_beqz(const DecodedInstruction& instruction);
+
+    void no_ext(std::string extension);
+    void unknown_rv16_opcode(std::uint16_t opcode);
+    void unknown_rv32_opcode(std::uint32_t opcode);
+    void unknown_zicsr_opcode(std::uint8_t funct3);
+    void unknown_load_opcode(std::uint8_t funct3);
+    void unknown_miscmem_opcode(std::uint8_t funct3);
+    void unknown_branch_opcode(std::uint8_t funct3);
+    void unknown_store_opcode(std::uint8_t funct3);
+    void unknown_amo_opcode(std::uint8_t funct3, std::uint8_t funct7);
+    void unknown_op_opcode(std::uint8_t funct3, std::uint8_t funct7);
+    void unknown_immediate_opcode(std::uint8_t funct3);
+    void unknown_compressed_opcode(std::uint8_t funct3);
+};
+
+// Picks the instantiation matching the extensions the core was built with
+template <std::uint8_t xlen, bool is_embedded>
+std::unique_ptr<CoreBackend> create_interpreter(RISCV<xlen, is_embedded>* core, bool threaded = false);
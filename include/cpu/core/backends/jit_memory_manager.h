@@ -0,0 +1,116 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
+#include <llvm/Support/Memory.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/*
+ * One mapping the sections of every JIT object are carved from, where
+ * SectionMemoryManager maps a few pages per object and never reuses them.
+ * Code and data share the reservation so RIP relative references between
+ * them always reach. The mapping is 2 MiB aligned and advised for
+ * transparent huge pages where the host has them, so thousands of small
+ * blocks sit on a handful of iTLB entries. Hot code gets a region of its
+ * own, allocation is first fit from the bottom of each region so live code
+ * stays packed, and freed ranges are merged and handed out again.
+ *
+ * Nothing is ever writable and executable at once. The arena is backed by
+ * a memory file mapped twice: the runtime view blocks run from is read and
+ * execute for code and read only for constants, the writable view is a
+ * separate mapping only the linker uses to copy and relocate sections.
+ * Flipping page protections instead would hit pages that hold blocks other
+ * threads are running, and split the huge pages. Without memfd the arena
+ * stays unmapped and every section gets pages of its own.
+ */
+class JITArena {
+public:
+    enum class Region { HotCode, Code, ReadOnlyData, Data, Count };
+
+    // Both data regions get data_size
+    JITArena(std::size_t hot_code_size, std::size_t code_size, std::size_t data_size);
+    ~JITArena();
+
+    JITArena(const JITArena&) = delete;
+    JITArena& operator=(const JITArena&) = delete;
+
+    // Null when the region has no room left, or the arena couldn't be mapped at all. The
+    // address is in the writable view, runtime_address() is where the section will run
+    std::uint8_t* allocate(Region region, std::size_t size, std::size_t alignment);
+    void release(Region region, std::uint8_t* address, std::size_t size);
+    std::uint64_t runtime_address(const std::uint8_t* address) const;
+
+    // Where mappings made when the arena is full should go to stay in reach of it
+    const llvm::sys::MemoryBlock& mapping() const { return memory; }
+
+private:
+    struct Span {
+        std::uint8_t* base = nullptr;
+        std::size_t size = 0;
+        // Nothing at or above end was handed out yet
+        std::size_t end = 0;
+        // Offset to size, below end only and never adjacent to each other
+        std::map<std::size_t, std::size_t> free_ranges;
+    };
+
+    // Reservation the runtime view is placed in
+    llvm::sys::MemoryBlock memory;
+    std::uint8_t* runtime_base = nullptr;
+    std::uint8_t* writable_base = nullptr;
+    std::size_t total_size = 0;
+    // Spans are in the writable view
+    std::array<Span, static_cast<std::size_t>(Region::Count)> spans;
+    // Workers link blocks while the emulation thread frees them
+    std::mutex mutex;
+    bool reported_full = false;
+
+    // Caller holds the mutex, offset and size are already rounded to the granule
+    void release(Span& span, std::size_t offset, std::size_t size);
+};
+
+/*
+ * The memory manager RTDyldObjectLinkingLayer makes for each object, it
+ * takes the object's sections from the arena and gives them back when ORC
+ * drops the object, which is when its JITDylib is removed. Sections are
+ * written through the arena's writable view and relocated for its runtime
+ * view, the only addresses the rest of the JIT ever sees.
+ */
+class JITArenaMemoryManager : public llvm::RTDyldMemoryManager {
+public:
+    JITArenaMemoryManager(JITArena& arena, bool hot);
+    ~JITArenaMemoryManager() override;
+
+    std::uint8_t* allocateCodeSection(uintptr_t size, unsigned alignment, unsigned section_id,
+                                      llvm::StringRef section_name) override;
+    std::uint8_t* allocateDataSection(uintptr_t size, unsigned alignment, unsigned section_id,
+                                      llvm::StringRef section_name, bool read_only) override;
+    void notifyObjectLoaded(llvm::RuntimeDyld& dyld, const llvm::object::ObjectFile& object) override;
+    void registerEHFrames(std::uint8_t* address, std::uint64_t load_address, std::size_t size) override;
+    bool finalizeMemory(std::string* error) override;
+
+private:
+    struct Allocation {
+        JITArena::Region region;
+        std::uint8_t* address;
+        std::size_t size;
+    };
+
+    struct OverflowBlock {
+        JITArena::Region region;
+        llvm::sys::MemoryBlock block;
+    };
+
+    JITArena& arena;
+    bool hot;
+    std::vector<Allocation> allocations;
+    // Only when the arena was full, mapped on their own like SectionMemoryManager does and
+    // protected once linked, each one is the only section on its pages
+    std::vector<OverflowBlock> overflow;
+
+    // Out of the arena if it has room, mapped on its own otherwise
+    std::uint8_t* allocate(JITArena::Region region, std::size_t size, std::size_t alignment);
+};
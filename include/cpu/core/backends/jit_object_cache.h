@@ -0,0 +1,53 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/IR/Module.h>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/*
+ * Keeps the objects LLJIT emits for JIT blocks on disk, so a later run of
+ * the same guest code skips optimization and codegen. Callers name the
+ * module with module_name() from a hash of everything that shapes the
+ * block's code. The host triple, CPU and LLVM version are folded into the
+ * file name here, so objects never cross toolchains or machines. Files are
+ * written under a temporary name and renamed into place, which lets several
+ * emulators share one directory.
+ *
+ * Each cache version gets a subdirectory of its own and the ones of other
+ * versions are deleted on startup. Past MAX_BYTES the least recently used
+ * objects are evicted, hits refresh an object's modification time.
+ */
+class JITObjectCache : public llvm::ObjectCache {
+public:
+    static constexpr std::uintmax_t MAX_BYTES = 128 * 1024 * 1024;
+
+    JITObjectCache(std::filesystem::path directory, std::uint32_t version);
+
+    // $XDG_CACHE_HOME/risky/jit, falling back to ~/.cache/risky/jit, empty when neither is known
+    // or persistence is turned off with RISKY_JIT_CACHE=0
+    static std::filesystem::path default_directory();
+    static std::string module_name(std::uint64_t key);
+
+    bool contains(const llvm::Module& module) const;
+
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override;
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override;
+
+private:
+    std::filesystem::path directory;
+    std::string host_suffix;
+    // Objects are written by every compile worker
+    std::mutex mutex;
+    std::uintmax_t total_bytes = 0;
+
+    void remove_other_versions(const std::filesystem::path& parent);
+    // Caller holds the mutex, deletes the oldest objects until a quarter of the limit is free again
+    void evict();
+
+    // Empty for modules that weren't named through module_name()
+    std::filesystem::path object_path(const llvm::Module& module) const;
+};
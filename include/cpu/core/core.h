@@ -2,7 +2,10 @@
 
 enum class EmulationType {
     Interpreter,
-    JIT
+    JIT,
+    Threaded,
+    // Interprets until a block gets hot, then hands it to the JIT
+    Tiered
 };
 
 #include <functional>
@@ -15,7 +18,7 @@ enum class EmulationType {
 #include <cpu/core/rv32/rv32i.h>
 #include <cpu/core/rv32/rv32e.h>
 #include <cpu/core/rv64/rv64i.h>
-#include <cpu/core/rv32/backends/rv32i_interpreter.h>
+#include <cpu/core/backends/interpreter.h>
 #include <cpu/core/rv32/backends/rv32i_jit.h>
 
 // Define Core class
@@ -32,7 +35,7 @@ public:
     std::function<void()> step;
     std::function<void()> stop;
     std::function<void()> reset;
-    std::function<void()> run;
+    std::function<ExitReason(std::uint64_t)> run;
 
     // Assign a new RISCV instance to Core
     template <std::uint8_t xlen, bool is_embedded>
@@ -44,7 +47,7 @@ public:
         bus_write32 = [riscv](std::uint32_t address, std::uint32_t value) { riscv->bus.write32(address, value); };
         step = [riscv]() { riscv->step(); };
         reset = [riscv]() { riscv->reset(); };
-        run = [riscv]() { riscv->run(); };
+        run = [riscv](std::uint64_t max_instructions) { return riscv->run(max_instructions); };
         stop = [riscv]() { riscv->stop(); };
 
         pc = [riscv]() -> std::any { return std::any(riscv->pc); };
@@ -104,7 +107,7 @@ public:
     }
 
     void start_() {
-        steppingThread.start([this]() { this->run(); });
+        steppingThread.start([this](std::uint64_t max_instructions) { return this->run(max_instructions); });
     }
 
     void stop_() {
@@ -119,6 +122,10 @@ public:
         return steppingThread.checkAndClearUpdateFlag();
     }
 
+    ExitReason last_exit_reason() const {
+        return steppingThread.lastExitReason();
+    }
+
     EmulationType get_emulation_type() const {
         return emulationType;
     }
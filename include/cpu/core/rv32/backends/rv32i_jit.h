@@ -1,49 +1,319 @@
 #pragma once
 
+#include <bus/bus.h>
 #include <cpu/core/backend.h>
+#include <cpu/core/backends/jit_memory_manager.h>
+#include <cpu/core/backends/jit_object_cache.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class RV32I;
 
-class RV32IJIT : public CoreBackend, public JITBackend {
+class RV32IJIT : public CoreBackend, public JITBackend, public CodeWriteObserver {
 public:
-    RV32IJIT(RV32I* core);
+    RV32IJIT(RV32I* core, bool tiered = false);
     ~RV32IJIT();
     void execute_opcode(std::uint32_t opcode) override;
     void step() override;
-    void run() override;
+    ExitReason run(std::uint64_t max_instructions) override;
 
-    const std::unordered_map<uint32_t, CompiledBlock>& get_block_cache() const override {
-        return block_cache;
-    }
+    std::vector<CompiledBlock> get_compiled_blocks() const override;
+
+    void set_tier_thresholds(std::uint32_t compile_threshold, std::uint32_t optimize_threshold) override;
+    void set_opt_level(std::uint8_t level) override;
+    void set_compile_workers(unsigned count) override;
+    void code_written(std::uint32_t address) override;
 
 private:
+    // Eviction starts once either limit is hit
     static constexpr size_t CACHE_SIZE = 1024;
+    static constexpr size_t CODE_CACHE_BYTES = 16 * 1024 * 1024;
+    // JIT arena regions, sections and stubs come on top of the code size and retired blocks hold on to theirs a while
+    static constexpr size_t HOT_CODE_ARENA_BYTES = CODE_CACHE_BYTES;
+    static constexpr size_t CODE_ARENA_BYTES = 2 * CODE_CACHE_BYTES;
+    static constexpr size_t DATA_ARENA_BYTES = CODE_CACHE_BYTES;
+    // Cold entry counters are dropped wholesale past this so they can't grow forever
+    static constexpr size_t MAX_HOTNESS_ENTRIES = 1 << 16;
+    // EmulationType::Tiered waits for this many entries, plain JIT compiles every block on its first one
+    static constexpr std::uint32_t TIERED_COMPILE_THRESHOLD = 64;
+    // Native runs before a block is recompiled as the head of a trace
+    static constexpr std::uint32_t OPTIMIZE_THRESHOLD = 4096;
+    // Plain JIT only compiles once so it pays for a light pipeline, tiered leaves that to tier 2
+    static constexpr std::uint8_t JIT_OPT_LEVEL = 1;
+    static constexpr std::uint8_t TIERED_OPT_LEVEL = 0;
+    // Tier 2 recompiles never use less than this
+    static constexpr std::uint8_t OPTIMIZED_TIER_OPT_LEVEL = 2;
+    static constexpr std::uint32_t MAX_BLOCK_INSTRUCTIONS = 256;
+    // A trace follows a block's exit when it took at least this share of the block's exits
+    static constexpr std::uint32_t TRACE_BIAS_PERCENT = 90;
+    static constexpr std::size_t MAX_TRACE_BLOCKS = 8;
+    // Two per conditional branch and one for a call's return address, plus the way out of a trace that loops
+    static constexpr std::size_t MAX_BLOCK_EXITS = 3 * MAX_TRACE_BLOCKS + 1;
+    // Deeper calls overwrite the oldest predictions, a power of two
+    static constexpr std::uint32_t RETURN_STACK_SIZE = 32;
+    // Branch weight of the in-place RAM path against the bus helper
+    static constexpr std::uint32_t RAM_ACCESS_WEIGHT = 2000;
+    // Part of every object cache key, bump it whenever the IR a block compiles to changes
+    static constexpr std::uint32_t OBJECT_CACHE_VERSION = 7;
+
+    struct BlockEntry;
+    struct ReturnStack;
+
+    // Guest state blocks get a pointer to as their only argument, the layout is mirrored by state_type
+    struct JITState {
+        uint32_t* registers;
+        uint32_t* pc;
+        uint32_t* csrs;
+        Bus* bus;
+        // Instructions chained blocks may still run before they have to return to dispatch()
+        std::int64_t chain_budget;
+        // RAM as loads and stores access it in place, see emit_read()
+        std::uint8_t* memory;
+        const std::uint8_t* code_pages;
+        std::uint32_t memory_size;
+        // Blocks by PC for jumps only known at run time, see block_entry()
+        BlockEntry* const* block_directory;
+        ReturnStack* return_stack;
+    };
+
+    // Why a block returned, in the upper half of its return value with the PC it stopped at in the lower one
+    enum class BlockExit : uint32_t {
+        // The static successor has no native code yet
+        Unlinked,
+        // The JALR target missed block_directory
+        Indirect,
+        BudgetExhausted
+    };
+
+    enum JITStateField : unsigned {
+        STATE_REGISTERS,
+        STATE_PC,
+        STATE_CSRS,
+        STATE_BUS,
+        STATE_CHAIN_BUDGET,
+        STATE_MEMORY,
+        STATE_CODE_PAGES,
+        STATE_MEMORY_SIZE,
+        STATE_BLOCK_DIRECTORY,
+        STATE_RETURN_STACK,
+        STATE_FIELD_COUNT
+    };
+
+    // Per-block state, handed to the block as its second argument so its code never embeds a host address
+    struct BlockRuntime {
+        // Native code for each static successor, null until it's compiled and linked
+        void* next[MAX_BLOCK_EXITS] = {};
+        BlockRuntime* next_runtime[MAX_BLOCK_EXITS] = {};
+        uint32_t targets[MAX_BLOCK_EXITS] = {};
+        // Only counted by tier 1 code, it's what traces are picked from
+        uint64_t exit_counts[MAX_BLOCK_EXITS] = {};
+        uint8_t link_count = 0;
+        uint64_t executions = 0;
+        // Most guest instructions one call runs before it reaches a budget check, every segment of a trace
+        // counted, nothing enters the block with less budget than that left
+        uint32_t max_instructions = 0;
+        // Inline cache for the JALR the block ends in, the entry stays valid as long as the JIT does
+        uint32_t indirect_target = 0;
+        BlockEntry* indirect_entry = nullptr;
+    };
+
+    // What dispatch() and indirect jumps need to enter a published block, code and runtime are read by JIT code too
+    struct BlockEntry {
+        void* code = nullptr;
+        BlockRuntime* runtime = nullptr;
+        CompiledBlock* block = nullptr;
+    };
+
+    // Pushed by calls, a return whose target matches the top goes straight to next[slot] of the caller
+    struct ReturnEntry {
+        uint32_t pc = 0;
+        uint32_t slot = 0;
+        BlockRuntime* runtime = nullptr;
+    };
+
+    struct ReturnStack {
+        ReturnEntry entries[RETURN_STACK_SIZE];
+        uint32_t top = 0;
+    };
+
+    struct BlockState {
+        // Each block owns its code through a JITDylib of its own, removing it frees the memory. Symbol
+        // names repeat when a dropped block is recompiled before the emulation thread got to free it
+        llvm::orc::JITDylib* dylib = nullptr;
+        std::unique_ptr<BlockRuntime> runtime;
+        std::list<uint32_t>::iterator clock_position;
+        // runtime->executions when the clock hand last passed, if it moved the block was used
+        uint64_t clock_executions = 0;
+    };
+
     std::unordered_map<uint32_t, CompiledBlock> block_cache;
-    std::vector<uint32_t> lru_queue;
+    std::unordered_map<uint32_t, BlockState> block_states;
+    // Held by the emulation thread while it's inside the backend, nothing else touches block_cache then
+    mutable std::mutex emulation_mutex;
+    // What get_compiled_blocks() hands out while a run() holds the mutex, refreshed when that run() ends
+    mutable std::mutex snapshot_mutex;
+    std::vector<CompiledBlock> block_cache_snapshot;
+    mutable std::atomic<bool> snapshot_requested{false};
+    // Link slots that should point at the block starting at a PC, filled in whenever it's published
+    std::unordered_map<uint32_t, std::vector<std::pair<BlockRuntime*, uint8_t>>> incoming_links;
+    JITState state;
+    // Published blocks in RAM, one array of entries per code page with a slot for every instruction in
+    // it, allocated when the page gets its first block. block_cache stays the owner and covers the rest
+    std::vector<BlockEntry*> block_directory;
+    std::vector<std::unique_ptr<BlockEntry[]>> block_pages;
+    // Return predictions name the caller's runtime, so it's cleared whenever blocks are freed
+    ReturnStack return_stack;
+    // CLOCK ring over compiled blocks, the hand points at the next eviction candidate
+    std::list<uint32_t> clock_ring;
+    std::list<uint32_t>::iterator clock_hand = clock_ring.end();
+    size_t code_bytes = 0;
+    // Requested and compiled blocks by the code page they come from, blocks never straddle pages
+    std::unordered_map<uint32_t, std::unordered_set<uint32_t>> page_blocks;
+    // Invalidations per code page, a compile that started before the latest one translated stale code
+    std::unordered_map<uint32_t, uint32_t> page_writes;
+    // Dropped blocks whose code may still be on the stack, freed once control is back in dispatch()
+    std::vector<BlockState> retired_blocks;
+
+    // Function sizes read from each emitted object, keyed by symbol, until the worker claims them. ORC
+    // links a block inside the lookup() of the worker that compiled it, so every worker only sees its own
+    static thread_local std::unordered_map<std::string, size_t> code_sizes;
     uint64_t execution_count = 0;
-    bool single_instruction_mode = false;
 
-    CompiledBlock* compile_block(uint32_t pc, bool single_instruction);
-    void link_blocks();
-    void evict_oldest_block();
+    std::uint32_t compile_threshold = 1;
+    std::uint32_t optimize_threshold = OPTIMIZE_THRESHOLD;
+    // Read by the compile workers, the frontend may change it while blocks are compiling
+    std::atomic<std::uint8_t> opt_level{JIT_OPT_LEVEL};
+    // Entries into code we don't have a block for yet, keyed by PC
+    std::unordered_map<uint32_t, std::uint32_t> block_hotness;
+    // Set when the next dispatch starts a new block, after a jump, branch or compiled block
+    bool at_block_entry = true;
+
+    struct CompileRequest {
+        uint32_t pc;
+        uint8_t tier;
+        // page_writes of the block's page when it was requested
+        uint32_t page_writes;
+        // Start PCs of the guest blocks to compile as one, pc first, see select_trace()
+        std::vector<uint32_t> trace;
+        // The page every block of the trace is on, copied when it was requested so the worker never reads guest memory
+        std::vector<uint32_t> code;
+        // The last block's hot exit goes back to pc
+        bool trace_loops = false;
+        // Entries or native runs when it was requested, the queue hands out the hottest block first
+        uint64_t heat = 0;
+        uint64_t sequence = 0;
+    };
+
+    // Orders the heap in compile_queue: tier 1 first since it's what gets code out of the interpreter,
+    // then the hottest, then the oldest
+    static bool compiles_after(const CompileRequest& a, const CompileRequest& b);
+
+    // A block handed back by the compile worker, the dylib is null when it couldn't be compiled
+    struct FinishedBlock {
+        CompiledBlock block;
+        BlockState state;
+        uint32_t page_writes;
+    };
+
+    // Guest code keeps running on this while its blocks are being compiled
+    std::unique_ptr<CoreBackend> fallback;
+
+    // One per host core the emulation thread doesn't need unless set_compile_workers() says otherwise,
+    // they share the queue and the LLJIT
+    std::vector<std::thread> compile_workers;
+    std::mutex compile_mutex;
+    std::condition_variable compile_cv;
+    std::vector<CompileRequest> compile_queue;
+    uint64_t request_count = 0;
+    std::vector<FinishedBlock> finished_blocks;
+    std::atomic<bool> has_finished{false};
+    bool stop_worker = false;
+    // Queued, compiling or uncompilable blocks, only touched by the emulation thread
+    std::unordered_set<uint32_t> requested_blocks;
+    // Blocks already queued for their optimized recompile
+    std::unordered_set<uint32_t> optimize_requested;
+
+    ExitReason run_blocks(std::uint64_t max_instructions);
+    // Runs one compiled block, or one interpreted instruction while it isn't compiled yet
+    ExitReason dispatch(std::uint64_t& retired, std::uint64_t budget);
+    void compile_worker_loop();
+    void start_compile_workers(unsigned count);
+    // Joins every worker, whatever they were compiling still gets published
+    void stop_compile_workers();
+    // block_cache as get_compiled_blocks() hands it out, the caller has to hold emulation_mutex
+    std::vector<CompiledBlock> list_blocks() const;
+    void request_compile(uint32_t pc, uint8_t tier, uint64_t heat);
+    void publish_finished_blocks();
+    // Follows the profiled hot exits from request.pc through compiled blocks on its page
+    void select_trace(CompileRequest& request);
+    FinishedBlock compile_block(const CompileRequest& request);
+    void optimize_module(llvm::Module& module, std::uint8_t level);
+    // Point a published block's exits at its successors, and its predecessors' exits at it
+    void link_block(uint32_t pc);
+    void unlink_block(uint32_t pc);
+    void release_block(uint32_t pc);
+    // Forgets a block entirely, it gets compiled again once it's hot again
+    void discard_block(uint32_t pc);
+    void free_retired_blocks();
+    void evict_block();
+    void record_code_sizes(const llvm::MemoryBuffer& object);
     CompiledBlock* find_block(uint32_t pc);
+    // Null for PCs outside RAM, or misaligned ones, and for pages without an array unless create is set
+    BlockEntry* block_entry(uint32_t pc, bool create);
     std::tuple<bool, uint32_t, bool> generate_ir_for_opcode(uint32_t opcode, uint32_t current_pc);
 
     RV32I* core;
-    bool ready{false};
-    std::unique_ptr<llvm::LLVMContext> context;
-    std::unique_ptr<llvm::Module> module;
-    std::unique_ptr<llvm::IRBuilder<>> builder;
-    std::unique_ptr<llvm::ExecutionEngine> executionEngine;
+    // Both have to outlive the JIT, the cache is null when there's nowhere to keep it
+    std::unique_ptr<JITArena> code_arena;
+    std::unique_ptr<JITObjectCache> object_cache;
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    // Keeps dylib names unique across workers
+    std::atomic<uint64_t> dylib_count{0};
+
+    // Only used by a compile worker while it emits a block, so every worker thread has its own. Each
+    // block also gets its own LLVMContext, which is what lets ORC compile them side by side
+    static thread_local std::unique_ptr<llvm::IRBuilder<>> builder;
+    static thread_local BlockRuntime* current_runtime;
+    static thread_local uint8_t current_tier;
+    // Where the trace continues after the segment being emitted, exits to it branch to hot_path instead
+    static thread_local std::optional<uint32_t> hot_successor;
+    static thread_local llvm::BasicBlock* hot_path;
+    static thread_local llvm::StructType* state_type;
+    static thread_local llvm::Value* state_arg;
+    static thread_local llvm::Value* runtime_arg;
+    // State fields loaded once in the block's entry, indexed by JITStateField, the chain budget is never cached
+    static thread_local std::array<llvm::Value*, STATE_FIELD_COUNT> state_fields;
+    // Guest registers live in SSA values inside a block, loaded on first use and written back at its exits
+    static thread_local std::array<llvm::Value*, 32> register_values;
+    static thread_local uint32_t dirty_registers;
+    // In a trace that loops, registers live in allocas mem2reg turns into phis, and exits only
+    // write them back once the whole trace is emitted and every register it changes is known
+    static thread_local bool registers_in_slots;
+    static thread_local llvm::BasicBlock* entry_block;
+    static thread_local std::array<llvm::AllocaInst*, 32> register_slots;
+    using InsertMark = std::pair<llvm::BasicBlock*, llvm::Instruction*>;
+    static thread_local std::vector<InsertMark> deferred_flushes;
+    // Where the JALR ending the block goes, see emit_indirect_exit()
+    static thread_local llvm::Value* jump_target;
+    // The JALR is a return, or a call pushing the address after it, going by the link register hints
+    static thread_local bool jump_pops_return;
+    static thread_local std::optional<uint32_t> jump_pushes_return;
 
-    typedef void (RV32IJIT::*OpcodeHandler)(std::uint32_t, uint32_t&, RV32I*);
+    // Handlers return false, before emitting anything, for encodings left to the interpreter
+    typedef bool (RV32IJIT::*OpcodeHandler)(std::uint32_t, uint32_t&, RV32I*);
 
     struct OpcodeHandlerEntry {
         std::unordered_map<std::uint8_t, OpcodeHandler> funct3_map;
@@ -53,6 +323,8 @@ private:
     std::unordered_map<std::uint8_t, OpcodeHandlerEntry> opcode_table;
 
     void initialize_opcode_table();
+    // Bus accessors JIT code calls into, defined as absolute symbols in the main JITDylib
+    void register_helpers();
 
     void no_ext(std::string extension);
     void unknown_rv16_opcode(std::uint16_t opcode);
@@ -60,6 +332,75 @@ private:
     void unknown_branch_opcode(std::uint8_t funct3);
     void unknown_zicsr_opcode(std::uint8_t funct3);
 
-    void rv32i_csrrs(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
-    void rv32i_bne(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    // Typed pointer to the field at offset bytes into base
+    llvm::Value* field_pointer(llvm::Value* base, std::size_t offset, llvm::Type* type);
+    llvm::Value* runtime_field(std::size_t offset, llvm::Type* type);
+    llvm::Value* bus_pointer();
+    llvm::Value* chain_budget_pointer();
+    // Whether the chain budget covers everything the block behind runtime may run
+    llvm::Value* budget_covers(llvm::Value* budget, llvm::Value* runtime);
+    llvm::Value* load_register(std::uint8_t reg);
+    void store_register(std::uint8_t reg, llvm::Value* value);
+    // Stores every register the block changed, has to run on each path out of the block
+    void flush_registers();
+    void store_dirty_registers();
+    llvm::AllocaInst* register_slot(std::uint8_t reg);
+    // Remembers where the builder is so code that's only known later can be inserted there
+    InsertMark mark_position();
+    void insert_at(const InsertMark& mark);
+    void store_pc(llvm::Value* pc);
+    // Leaves the block for a statically known PC, tail calling the successor when it's linked
+    void emit_exit(uint32_t target_pc);
+    // Leaves for a PC computed at run time, tail calling the return stack's guess, the inline cache or
+    // whatever block_directory has for it, in that order
+    void emit_indirect_exit(llvm::Value* target);
+    // Gives the return address its own link slot and predicts the next return goes there
+    void push_return(uint32_t return_pc);
+    // Returns to dispatch(), pc and reason are i32
+    void emit_return(llvm::Value* pc, llvm::Value* reason);
+    llvm::Value* call_helper(const char* name, llvm::Type* return_type, std::initializer_list<llvm::Value*> args);
+    // RAM accesses that fit in memory go straight to the host, everything else calls the bus helper; reads are zero extended
+    llvm::Value* emit_read(llvm::Value* address, unsigned width);
+    void emit_write(llvm::Value* address, llvm::Value* value, unsigned width);
+    llvm::Value* ram_offset(llvm::Value* address, unsigned width, llvm::Value*& in_ram);
+
+    bool emit_branch(std::uint32_t opcode, uint32_t& current_pc, llvm::CmpInst::Predicate predicate);
+    bool emit_load(std::uint32_t opcode, uint32_t& current_pc, unsigned width, bool is_signed);
+    bool emit_store(std::uint32_t opcode, uint32_t& current_pc, unsigned width);
+    bool emit_csr(std::uint32_t opcode, uint32_t& current_pc, bool immediate);
+    llvm::Value* emit_muldiv(std::uint8_t funct3, llvm::Value* a, llvm::Value* b);
+
+    bool rv32i_lui(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_auipc(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_jal(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_jalr(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+
+    bool rv32i_beq(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_bne(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_blt(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_bge(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_bltu(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_bgeu(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+
+    bool rv32i_lb(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_lh(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_lw(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_lbu(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_lhu(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+
+    bool rv32i_sb(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_sh(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_sw(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+
+    bool rv32i_op_imm(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_op(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_fence(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32a_amo(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+
+    bool rv32i_csrrw(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_csrrs(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_csrrc(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_csrrwi(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_csrrsi(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
+    bool rv32i_csrrci(std::uint32_t opcode, uint32_t& current_pc, RV32I* core);
 };
\ No newline at end of file
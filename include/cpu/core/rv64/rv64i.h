@@ -2,10 +2,19 @@
 
 #include <cpu/core/core.h>
 #include <cpu/riscv.h>
+#include <memory>
+#include <cpu/core/backend.h>
 
 class RV64I : public RISCV<64> {
 public:
 	RV64I(const std::vector<std::string>& extensions, EmulationType type);
+	void set_backend(std::unique_ptr<CoreBackend> backend);
 
-	void executeInstruction(std::uint32_t opcode);
+	CoreBackend *get_backend() {
+		return backend.get();
+	}
+
+private:
+	void execute_opcode(std::uint32_t opcode);
+	std::unique_ptr<CoreBackend> backend;
 };
@@ -7,6 +7,7 @@
 #include <unordered_map>
 
 #include <bus/bus.h>
+#include <cpu/core/backend.h>
 #include <log/log.hh>
 #include "risky.h"
 
@@ -15,9 +16,11 @@
 #define LOAD    0b0000011
 #define MISCMEM 0b0001111
 #define OPIMM   0b0010011
+#define OPIMM32 0b0011011
 #define STORE   0b0100011
 #define AMO     0b0101111
 #define OP      0b0110011
+#define OP32    0b0111011
 #define BRANCH  0b1100011
 #define SYSTEM  0b1110011
 
@@ -37,7 +40,7 @@ public:
 	Bus bus;
 
 	std::function<void()> step;
-	std::function<void()> run;
+	std::function<ExitReason(std::uint64_t)> run;
 	void run_();
 	void step_();
 	void stop();
@@ -45,7 +48,7 @@ public:
 	void reset();
 
 	void set_step_func(std::function<void()> step_func);
-	void set_run_func(std::function<void()> run_func);
+	void set_run_func(std::function<ExitReason(std::uint64_t)> run_func);
 
 	std::uint32_t fetch_opcode();
 	std::uint32_t fetch_opcode(addr_t pc);
@@ -103,6 +106,11 @@ public:
 
 private:
 	std::vector<std::string> extensions;
+
+	// Host view of the RAM page the last instruction fetch hit. RAM never
+	// moves, so stores land in it directly and only a page change refills it
+	std::uint8_t* fetch_page = nullptr;
+	addr_t fetch_page_base = ~static_cast<addr_t>(0);
 };
 
 #include <cpu/riscv.tpp>
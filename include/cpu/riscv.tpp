@@ -4,6 +4,7 @@
 #include <log/log.hh>
 #include <risky.h>
 #include <cstring>
+#include <bit>
 
 #if __has_include(<format>)
 #include <format>
@@ -73,18 +74,32 @@ void RISCV<XLEN, is_embedded>::set_step_func(std::function<void()> step_func) {
 }
 
 template <std::uint8_t XLEN, bool is_embedded>
-void RISCV<XLEN, is_embedded>::set_run_func(std::function<void()> run_func) {
+void RISCV<XLEN, is_embedded>::set_run_func(std::function<ExitReason(std::uint64_t)> run_func) {
 	run = std::move(run_func);
 }
 
 template <std::uint8_t xlen, bool is_embedded>
 std::uint32_t RISCV<xlen, is_embedded>::fetch_opcode() {
-	return bus.read32(pc);
+	return fetch_opcode(pc);
 }
 
 template <std::uint8_t xlen, bool is_embedded>
 std::uint32_t RISCV<xlen, is_embedded>::fetch_opcode(addr_t pc) {
 	static_assert(xlen == 32 || xlen == 64 || xlen == 128, "Unsupported XLEN");
-    
+
+	addr_t page_base = pc & ~static_cast<addr_t>(CODE_PAGE_SIZE - 1);
+
+	if (page_base != fetch_page_base) {
+		fetch_page = bus.host_page(page_base);
+		fetch_page_base = page_base;
+	}
+
+	// Aligned fetches can't cross the page, anything else (or MMIO) takes the bus path
+	if (std::endian::native == std::endian::little && fetch_page && (pc & 3) == 0) {
+		std::uint32_t opcode;
+		std::memcpy(&opcode, fetch_page + (pc & (CODE_PAGE_SIZE - 1)), sizeof(opcode));
+		return opcode;
+	}
+
 	return bus.read32(pc);
 }
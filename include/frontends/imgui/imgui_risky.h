@@ -30,6 +30,7 @@ public:
     void imgui_registers_window_64(Core *core, bool *debug_window);
     void imgui_disassembly_window_32(Core *core);
 	void imgui_llvm_ir_blocks_window(Core *core);
+	void imgui_fusion_stats_window(Core *core);
 
 private:
 	std::unique_ptr<RV32I> riscv_core_32;
@@ -4,23 +4,29 @@
 #include <atomic>
 #include <functional>
 #include <chrono>
+#include <cstdint>
+#include <cpu/core/backend.h>
 #include "risky.h"
 
 class SteppingThread {
 public:
-	SteppingThread() : running(false), updateFlag(false) {}
+	// Guest instructions handed to the backend per run() call
+	static constexpr std::uint64_t RUN_QUANTUM = 100000;
+
+	SteppingThread() : running(false), updateFlag(false), exitReason(ExitReason::BudgetExhausted) {}
 
 	~SteppingThread() {
 		stop();
 	}
 
-	void start(const std::function<void()>& stepFunction) {
+	void start(const std::function<ExitReason(std::uint64_t)>& runFunction) {
 		if (running.exchange(true)) return;
-		stepThread = std::thread([this, stepFunction]() {
+		stepThread = std::thread([this, runFunction]() {
 			while (running) {
-				stepFunction();
+				ExitReason reason = runFunction(RUN_QUANTUM);
+				exitReason.store(reason, std::memory_order_relaxed);
 				updateFlag.store(true, std::memory_order_release);
-				if (Risky::is_aborted()) break;
+				if (reason != ExitReason::BudgetExhausted || Risky::is_aborted()) break;
 			}
 			running = false;
 		});
@@ -41,8 +47,13 @@ public:
 		return updateFlag.exchange(false, std::memory_order_acquire);
 	}
 
+	ExitReason lastExitReason() const {
+		return exitReason.load(std::memory_order_relaxed);
+	}
+
 private:
 	std::thread stepThread;
 	std::atomic<bool> running;
 	std::atomic<bool> updateFlag;
+	std::atomic<ExitReason> exitReason;
 };
@@ -2,12 +2,15 @@
 #include <log/log.hh>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 Bus::Bus()
 {
 	Logger::set_subsystem("BUS");
 	main_memory_size = 16 * 1024 * 1024;
 	main_memory = new std::uint8_t[main_memory_size];
+	// One spare entry so a word store at the very end of RAM can be checked
+	code_pages.assign((main_memory_size >> CODE_PAGE_SHIFT) + 1, 0);
 }
 
 Bus::~Bus() {
@@ -50,6 +53,64 @@ void Bus::load_binary(const std::string& binary_path)
 	}
 
 	binary_file.close();
+
+	// The image was copied straight into RAM, drop anything decoded from it
+	invalidate_code_pages();
+}
+
+void Bus::invalidate_code_pages()
+{
+	for (std::size_t page = 0; page < code_pages.size(); page++) {
+		if (code_pages[page]) {
+			code_page_written(page << CODE_PAGE_SHIFT);
+		}
+	}
+}
+
+void Bus::add_code_observer(CodeWriteObserver* observer)
+{
+	code_observers.push_back(observer);
+}
+
+void Bus::remove_code_observer(CodeWriteObserver* observer)
+{
+	code_observers.erase(std::remove(code_observers.begin(), code_observers.end(), observer), code_observers.end());
+}
+
+void Bus::mark_code_page(std::uint32_t address)
+{
+	if (address >= RAM_BASE && address < (RAM_BASE + main_memory_size))
+	{
+		code_pages[(address - RAM_BASE) >> CODE_PAGE_SHIFT] = 1;
+	}
+}
+
+std::uint8_t* Bus::host_page(std::uint32_t address)
+{
+	if (address >= RAM_BASE && address < (RAM_BASE + main_memory_size))
+	{
+		return main_memory + ((address - RAM_BASE) & ~static_cast<std::size_t>(CODE_PAGE_SIZE - 1));
+	}
+
+	return nullptr;
+}
+
+void Bus::code_page_written(std::size_t offset)
+{
+	std::size_t page = offset >> CODE_PAGE_SHIFT;
+
+	if (page >= code_pages.size() || !code_pages[page])
+	{
+		return;
+	}
+
+	// Observers re-mark the page once they decode from it again
+	code_pages[page] = 0;
+
+	for (CodeWriteObserver* observer : code_observers)
+	{
+		observer->code_written(RAM_BASE + static_cast<std::uint32_t>(page << CODE_PAGE_SHIFT));
+	}
 }
 
 std::uint8_t Bus::read8(std::uint32_t address)
@@ -128,6 +189,8 @@ void Bus::write8(std::uint32_t address, std::uint8_t value)
 		std::size_t offset = address - 0x80000000;
 
 		main_memory[offset] = static_cast<std::uint8_t>(value);
+
+		check_code_write(offset, 1);
 	}
 	else
 	{
@@ -150,6 +213,8 @@ void Bus::write32(std::uint32_t address, std::uint32_t value)
 		main_memory[offset + 1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);
 		main_memory[offset + 2] = static_cast<std::uint8_t>((value >> 16) & 0xFF);
 		main_memory[offset + 3] = static_cast<std::uint8_t>((value >> 24) & 0xFF);
+
+		check_code_write(offset, 4);
 	}
 	else
 	{
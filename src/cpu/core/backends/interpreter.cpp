@@ -0,0 +1,1945 @@
+#include <cpu/core/backends/interpreter.h>
+#include <log/log.hh>
+#include <risky.h>
+#include <sstream>
+#include <bitset>
+#include <limits>
+#include <utility>
+#include <cpu/core/core.h>
+
+// OP, OP-32 and AMO are left illegal here, decode() resolves them through their own tables
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, Interpreter<xlen, is_embedded, extensions>::OPCODE_TABLE_SIZE>
+Interpreter<xlen, is_embedded, extensions>::build_opcode_table() {
+    std::array<Op, OPCODE_TABLE_SIZE> table{};
+    table.fill(Op::Illegal);
+
+    // U/J-type and JALR don't have a funct3 field, every slot gets the op
+    auto set_all = [&table](std::uint8_t opcode, Op op) {
+        for (std::size_t funct3 = 0; funct3 < 8; funct3++) {
+            table[(opcode << 3) | funct3] = op;
+        }
+    };
+
+    auto set = [&table](std::uint8_t opcode, std::uint8_t funct3, Op op) {
+        table[(opcode << 3) | funct3] = op;
+    };
+
+    set_all(AUIPC, Op::Auipc);
+    set_all(LUI, Op::Lui);
+    set_all(JAL, Op::Jal);
+    set_all(JALR, Op::Jalr);
+
+    set(LOAD, 0b000, Op::Lb);
+    set(LOAD, 0b001, Op::Lh);
+    set(LOAD, 0b010, Op::Lw);
+    set(LOAD, 0b100, Op::Lbu);
+    set(LOAD, 0b101, Op::Lhu);
+
+    if (IS_RV64) {
+        set(LOAD, 0b011, Op::Ld);
+        set(LOAD, 0b110, Op::Lwu);
+        set(STORE, 0b011, Op::Sd);
+
+        set(OPIMM32, 0b000, Op::Addiw);
+        set(OPIMM32, 0b001, Op::Slliw);
+        set(OPIMM32, 0b101, Op::Srliw);
+    }
+
+    set(MISCMEM, 0b000, Op::Fence);
+    set(MISCMEM, 0b001, HAS_ZIFENCEI ? Op::FenceI : Op::ZifenceiUnavailable);
+
+    set(OPIMM, 0b000, Op::Addi);
+    set(OPIMM, 0b001, Op::Slli);
+    set(OPIMM, 0b010, Op::Slti);
+    set(OPIMM, 0b011, Op::Sltiu);
+    set(OPIMM, 0b100, Op::Xori);
+    set(OPIMM, 0b101, Op::Srli);
+    set(OPIMM, 0b110, Op::Ori);
+    set(OPIMM, 0b111, Op::Andi);
+
+    set(STORE, 0b000, Op::Sb);
+    set(STORE, 0b001, Op::Sh);
+    set(STORE, 0b010, Op::Sw);
+
+    set(BRANCH, 0b000, Op::Beq);
+    set(BRANCH, 0b001, Op::Bne);
+    set(BRANCH, 0b100, Op::Blt);
+    set(BRANCH, 0b101, Op::Bge);
+    set(BRANCH, 0b110, Op::Bltu);
+    set(BRANCH, 0b111, Op::Bgeu);
+
+    auto csr = [](Op op) {
+        return HAS_ZICSR ? op : Op::ZicsrUnavailable;
+    };
+
+    set(SYSTEM, 0b001, csr(Op::Csrrw));
+    set(SYSTEM, 0b010, csr(Op::Csrrs));
+    set(SYSTEM, 0b011, csr(Op::Csrrc));
+    set(SYSTEM, 0b101, csr(Op::Csrrwi));
+    set(SYSTEM, 0b110, csr(Op::Csrrsi));
+    set(SYSTEM, 0b111, csr(Op::Csrrci));
+
+    return table;
+}
+
+// OP rows: 0 = illegal funct7, 1 = funct7 0x00, 2 = funct7 0x20, 3 = funct7 0x01 (M)
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, 8>, Interpreter<xlen, is_embedded, extensions>::OP_TABLE_ROWS>
+Interpreter<xlen, is_embedded, extensions>::build_op_table() {
+    std::array<std::array<Op, 8>, OP_TABLE_ROWS> table{};
+
+    for (auto& row : table) {
+        row.fill(Op::IllegalOp);
+    }
+
+    table[1][0b000] = Op::Add;
+    table[1][0b001] = Op::Sll;
+    table[1][0b010] = Op::Slt;
+    table[1][0b011] = Op::Sltu;
+    table[1][0b100] = Op::Xor;
+    table[1][0b101] = Op::Srl;
+    table[1][0b110] = Op::Or;
+    table[1][0b111] = Op::And;
+
+    table[2][0b000] = Op::Sub;
+    table[2][0b101] = Op::Sra;
+
+    if (!HAS_M) {
+        table[3].fill(Op::MUnavailable);
+        return table;
+    }
+
+    table[3][0b000] = Op::Mul;
+    table[3][0b001] = Op::Mulh;
+    table[3][0b010] = Op::Mulhsu;
+    table[3][0b011] = Op::Mulhu;
+    table[3][0b100] = Op::Div;
+    table[3][0b101] = Op::Divu;
+    table[3][0b110] = Op::Rem;
+    table[3][0b111] = Op::Remu;
+
+    return table;
+}
+
+// OP-32 uses the same rows as OP and only exists on RV64
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, 8>, Interpreter<xlen, is_embedded, extensions>::OP_TABLE_ROWS>
+Interpreter<xlen, is_embedded, extensions>::build_op32_table() {
+    std::array<std::array<Op, 8>, OP_TABLE_ROWS> table{};
+
+    for (auto& row : table) {
+        row.fill(IS_RV64 ? Op::IllegalOp : Op::Illegal);
+    }
+
+    if (!IS_RV64) {
+        return table;
+    }
+
+    table[1][0b000] = Op::Addw;
+    table[2][0b000] = Op::Subw;
+
+    return table;
+}
+
+// AMO .W operations, indexed by funct5 (opcode[31:27])
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, Interpreter<xlen, is_embedded, extensions>::AMO_TABLE_SIZE>
+Interpreter<xlen, is_embedded, extensions>::build_amo_table() {
+    std::array<Op, AMO_TABLE_SIZE> table{};
+    table.fill(HAS_A ? Op::IllegalAmo : Op::AUnavailable);
+
+    if (!HAS_A) {
+        return table;
+    }
+
+    table[0b00000] = Op::AmoaddW;
+    table[0b00001] = Op::AmoswapW;
+    table[0b00010] = Op::LrW;
+    table[0b00011] = Op::ScW;
+    table[0b00100] = Op::AmoxorW;
+    table[0b01000] = Op::AmoorW;
+    table[0b01100] = Op::AmoandW;
+    table[0b10000] = Op::AmominW;
+    table[0b10100] = Op::AmomaxW;
+    table[0b11000] = Op::AmominuW;
+    table[0b11100] = Op::AmomaxuW;
+
+    return table;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<typename Interpreter<xlen, is_embedded, extensions>::OpcodeHandler, Interpreter<xlen, is_embedded, extensions>::HANDLER_TABLE_SIZE>
+Interpreter<xlen, is_embedded, extensions>::build_handler_table() {
+    std::array<OpcodeHandler, HANDLER_TABLE_SIZE> table{};
+
+    auto set = [&table](Op op, OpcodeHandler handler) {
+        table[static_cast<std::size_t>(op)] = handler;
+    };
+
+    // Ops of a disabled extension (or another XLEN) are never decoded, keep them out of the table too
+    auto set_ext = [&set](bool enabled, Op op, OpcodeHandler handler, OpcodeHandler unavailable) {
+        set(op, enabled ? handler : unavailable);
+    };
+
+    set(Op::Decode, &Interpreter::decode_and_execute);
+    set(Op::Illegal, &Interpreter::illegal_instruction);
+    set(Op::IllegalOp, &Interpreter::illegal_op);
+    set(Op::IllegalAmo, &Interpreter::illegal_amo);
+    set(Op::MUnavailable, &Interpreter::m_unavailable);
+    set(Op::AUnavailable, &Interpreter::a_unavailable);
+    set(Op::ZicsrUnavailable, &Interpreter::zicsr_unavailable);
+    set(Op::ZifenceiUnavailable, &Interpreter::zifencei_unavailable);
+    set(Op::Auipc, &Interpreter::rv32i_auipc);
+    set(Op::Lui, &Interpreter::rv32i_lui);
+    set(Op::Jal, &Interpreter::rv32i_jal);
+    set(Op::Jalr, &Interpreter::rv32i_jalr);
+    set(Op::Lb, &Interpreter::rv32i_lb);
+    set(Op::Lw, &Interpreter::rv32i_lw);
+    set(Op::Lbu, &Interpreter::rv32i_lbu);
+    set(Op::Lh, &Interpreter::rv32i_lh);
+    set(Op::Lhu, &Interpreter::rv32i_lhu);
+    set(Op::Sub, &Interpreter::rv32i_sub);
+    set(Op::Add, &Interpreter::rv32i_add);
+    set(Op::Sll, &Interpreter::rv32i_sll);
+    set(Op::Sltu, &Interpreter::rv32i_sltu);
+    set(Op::Xor, &Interpreter::rv32i_xor);
+    set(Op::Or, &Interpreter::rv32i_or);
+    set(Op::And, &Interpreter::rv32i_and);
+    set(Op::Slt, &Interpreter::rv32i_slt);
+    set(Op::Srl, &Interpreter::rv32i_srl);
+    set(Op::Sra, &Interpreter::rv32i_sra);
+    set_ext(HAS_M, Op::Mul, &Interpreter::rv32i_mul, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Mulhu, &Interpreter::rv32i_mulhu, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Div, &Interpreter::rv32i_div, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Mulh, &Interpreter::rv32i_mulh, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Mulhsu, &Interpreter::rv32i_mulhsu, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Divu, &Interpreter::rv32i_divu, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Rem, &Interpreter::rv32i_rem, &Interpreter::m_unavailable);
+    set_ext(HAS_M, Op::Remu, &Interpreter::rv32i_remu, &Interpreter::m_unavailable);
+    set_ext(HAS_ZICSR, Op::Csrrw, &Interpreter::rv32i_csrrw, &Interpreter::zicsr_unavailable);
+    set_ext(HAS_ZICSR, Op::Csrrs, &Interpreter::rv32i_csrrs, &Interpreter::zicsr_unavailable);
+    set_ext(HAS_ZICSR, Op::Csrrc, &Interpreter::rv32i_csrrc, &Interpreter::zicsr_unavailable);
+    set_ext(HAS_ZICSR, Op::Csrrsi, &Interpreter::rv32i_csrrsi, &Interpreter::zicsr_unavailable);
+    set_ext(HAS_ZICSR, Op::Csrrwi, &Interpreter::rv32i_csrrwi, &Interpreter::zicsr_unavailable);
+    set_ext(HAS_ZICSR, Op::Csrrci, &Interpreter::rv32i_csrrci, &Interpreter::zicsr_unavailable);
+    set_ext(HAS_ZIFENCEI, Op::FenceI, &Interpreter::rv32i_fence_i, &Interpreter::zifencei_unavailable);
+    set(Op::Fence, &Interpreter::rv32i_fence);
+    set(Op::Ecall, &Interpreter::rv32i_ecall);
+    set(Op::Ebreak, &Interpreter::rv32i_ebreak);
+    set(Op::Wfi, &Interpreter::rv32i_wfi);
+    set(Op::Addi, &Interpreter::rv32i_addi);
+    set(Op::Slli, &Interpreter::rv32i_slli);
+    set(Op::Sltiu, &Interpreter::rv32i_sltiu);
+    set(Op::Srli, &Interpreter::rv32i_srli);
+    set(Op::Srai, &Interpreter::rv32i_srai);
+    set(Op::Andi, &Interpreter::rv32i_andi);
+    set(Op::Slti, &Interpreter::rv32i_slti);
+    set(Op::Xori, &Interpreter::rv32i_xori);
+    set(Op::Ori, &Interpreter::rv32i_ori);
+    set(Op::Beq, &Interpreter::rv32i_beq);
+    set(Op::Bne, &Interpreter::rv32i_bne);
+    set(Op::Blt, &Interpreter::rv32i_blt);
+    set(Op::Bge, &Interpreter::rv32i_bge);
+    set(Op::Bltu, &Interpreter::rv32i_bltu);
+    set(Op::Bgeu, &Interpreter::rv32i_bgeu);
+    set(Op::Sb, &Interpreter::rv32i_sb);
+    set(Op::Sw, &Interpreter::rv32i_sw);
+    set(Op::Sh, &Interpreter::rv32i_sh);
+    set_ext(HAS_A, Op::AmoorW, &Interpreter::rv32i_amoor_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmoaddW, &Interpreter::rv32i_amoadd_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmoswapW, &Interpreter::rv32i_amoswap_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmoxorW, &Interpreter::rv32i_amoxor_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmoandW, &Interpreter::rv32i_amoand_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmominW, &Interpreter::rv32i_amomin_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmomaxW, &Interpreter::rv32i_amomax_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmominuW, &Interpreter::rv32i_amominu_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::AmomaxuW, &Interpreter::rv32i_amomaxu_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::LrW, &Interpreter::rv32i_lr_w, &Interpreter::a_unavailable);
+    set_ext(HAS_A, Op::ScW, &Interpreter::rv32i_sc_w, &Interpreter::a_unavailable);
+    set_ext(IS_RV64, Op::Ld, &Interpreter::rv64i_ld, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Lwu, &Interpreter::rv64i_lwu, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Sd, &Interpreter::rv64i_sd, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Addiw, &Interpreter::rv64i_addiw, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Slliw, &Interpreter::rv64i_slliw, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Srliw, &Interpreter::rv64i_srliw, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Sraiw, &Interpreter::rv64i_sraiw, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Addw, &Interpreter::rv64i_addw, &Interpreter::illegal_instruction);
+    set_ext(IS_RV64, Op::Subw, &Interpreter::rv64i_subw, &Interpreter::illegal_instruction);
+    set(Op::LuiAddi, &Interpreter::fused_lui_addi);
+    set(Op::AuipcJalr, &Interpreter::fused_auipc_jalr);
+    set(Op::AuipcLw, &Interpreter::fused_auipc_lw);
+    set(Op::SltuBnez, &Interpreter::fused_sltu_bnez);
+    set(Op::SltuBeqz, &Interpreter::fused_sltu_beqz);
+    set(Op::SltiuBnez, &Interpreter::fused_sltiu_bnez);
+    set(Op::SltiuBeqz, &Interpreter::fused_sltiu_beqz);
+
+    return table;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, Interpreter<xlen, is_embedded, extensions>::OPCODE_TABLE_SIZE>
+Interpreter<xlen, is_embedded, extensions>::opcode_table = Interpreter<xlen, is_embedded, extensions>::build_opcode_table();
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, 8>, Interpreter<xlen, is_embedded, extensions>::OP_TABLE_ROWS>
+Interpreter<xlen, is_embedded, extensions>::op_table = Interpreter<xlen, is_embedded, extensions>::build_op_table();
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, 8>, Interpreter<xlen, is_embedded, extensions>::OP_TABLE_ROWS>
+Interpreter<xlen, is_embedded, extensions>::op32_table = Interpreter<xlen, is_embedded, extensions>::build_op32_table();
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<typename Interpreter<xlen, is_embedded, extensions>::Op, Interpreter<xlen, is_embedded, extensions>::AMO_TABLE_SIZE>
+Interpreter<xlen, is_embedded, extensions>::amo_table = Interpreter<xlen, is_embedded, extensions>::build_amo_table();
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<typename Interpreter<xlen, is_embedded, extensions>::OpcodeHandler, Interpreter<xlen, is_embedded, extensions>::HANDLER_TABLE_SIZE>
+Interpreter<xlen, is_embedded, extensions>::handler_table = Interpreter<xlen, is_embedded, extensions>::build_handler_table();
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+constexpr std::array<std::uint8_t, 128> Interpreter<xlen, is_embedded, extensions>::op_funct7_rows = [] {
+    std::array<std::uint8_t, 128> rows{};
+    rows[0x00] = 1;
+    rows[0x20] = 2;
+    rows[0x01] = 3;
+    return rows;
+}();
+
+template <std::uint8_t xlen, bool is_embedded>
+static std::uint32_t core_extensions(RISCV<xlen, is_embedded>* core) {
+    std::uint32_t extensions = 0;
+
+    if (core->has_m) {
+        extensions |= InterpreterExtension::M;
+    }
+
+    if (core->has_a) {
+        extensions |= InterpreterExtension::A;
+    }
+
+    if (core->has_zicsr) {
+        extensions |= InterpreterExtension::Zicsr;
+    }
+
+    if (core->has_zifencei) {
+        extensions |= InterpreterExtension::Zifencei;
+    }
+
+    return extensions;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+Interpreter<xlen, is_embedded, extensions>::Interpreter(RISCV<xlen, is_embedded>* core, bool threaded)
+    : core(core), threaded(threaded), enabled_extensions(core_extensions(core) & extensions) {
+    core->bus.add_code_observer(this);
+    ready = true;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+Interpreter<xlen, is_embedded, extensions>::~Interpreter() {
+    core->bus.remove_code_observer(this);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::size_t... profiles>
+static std::unique_ptr<CoreBackend> instantiate_interpreter(std::uint32_t extensions, RISCV<xlen, is_embedded>* core, bool threaded,
+                                                            std::index_sequence<profiles...>) {
+    std::unique_ptr<CoreBackend> backend;
+
+    ((!(extensions & ~InterpreterExtension::Profiles[profiles]) &&
+      (backend = std::make_unique<Interpreter<xlen, is_embedded, InterpreterExtension::Profiles[profiles]>>(core, threaded), true)) || ...);
+
+    return backend;
+}
+
+template <std::uint8_t xlen, bool is_embedded>
+std::unique_ptr<CoreBackend> create_interpreter(RISCV<xlen, is_embedded>* core, bool threaded) {
+    return instantiate_interpreter(core_extensions(core), core, threaded,
+                                   std::make_index_sequence<InterpreterExtension::Profiles.size()>{});
+}
+
+template std::unique_ptr<CoreBackend> create_interpreter<32, false>(RISCV<32, false>* core, bool threaded);
+template std::unique_ptr<CoreBackend> create_interpreter<32, true>(RISCV<32, true>* core, bool threaded);
+template std::unique_ptr<CoreBackend> create_interpreter<64, false>(RISCV<64, false>* core, bool threaded);
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::step() {
+    // Bypass the page cache, a fused slot would retire two instructions at once
+    DecodedInstruction instruction = decode(core->fetch_opcode());
+    (this->*instruction.handler)(instruction);
+    core->registers[0] = 0;
+    core->pc += 4;
+
+    // Single-stepping already stops after every instruction
+    exit_requested = false;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+ExitReason Interpreter<xlen, is_embedded, extensions>::run(std::uint64_t max_instructions) {
+    if (max_instructions == 0) {
+        return ExitReason::BudgetExhausted;
+    }
+
+    if (threaded) {
+        return run_threaded(max_instructions);
+    }
+
+    DecodedInstruction first_half;
+
+    for (std::uint64_t executed = 0; executed < max_instructions; executed++) {
+        const DecodedInstruction* instruction = &fetch_decoded(core->pc);
+
+        // Fused pairs retire two instructions, so the slot has to be decoded
+        // before the budget can be charged for it
+        if (instruction->op == Op::Decode) {
+            instruction = &decode_slot(*instruction);
+        }
+
+        if (static_cast<std::size_t>(instruction->op) >= FIRST_FUSED_OP) {
+            // With a single instruction left only the first half may retire
+            if (executed + 1 == max_instructions) {
+                first_half = decode(core->fetch_opcode());
+                instruction = &first_half;
+            } else {
+                executed++;
+            }
+        }
+
+        (this->*instruction->handler)(*instruction);
+        core->registers[0] = 0;
+        core->pc += 4;
+
+        // Handlers that abort also request an exit, the abort flag itself is
+        // only looked at once the quantum is over
+        if (exit_requested) {
+            break;
+        }
+    }
+
+    return take_exit_reason();
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::request_exit(ExitReason reason) {
+    exit_requested = true;
+    requested_exit = reason;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+ExitReason Interpreter<xlen, is_embedded, extensions>::take_exit_reason() {
+    if (Risky::is_aborted()) {
+        exit_requested = false;
+        return ExitReason::Error;
+    }
+
+    if (exit_requested) {
+        exit_requested = false;
+        return requested_exit;
+    }
+
+    return ExitReason::BudgetExhausted;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::execute_opcode(std::uint32_t opcode) {
+    DecodedInstruction instruction = decode(opcode);
+    (this->*instruction.handler)(instruction);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+typename Interpreter<xlen, is_embedded, extensions>::DecodedInstruction Interpreter<xlen, is_embedded, extensions>::decode(std::uint32_t opcode) const {
+    DecodedInstruction instruction;
+    std::uint8_t funct3 = (opcode >> 12) & 0x7;
+
+    instruction.opcode = opcode;
+    instruction.rd = (opcode >> 7) & 0x1F;
+    instruction.rs1 = (opcode >> 15) & 0x1F;
+    instruction.rs2 = (opcode >> 20) & 0x1F;
+    instruction.op = opcode_table[((opcode & 0x7F) << 3) | funct3];
+
+    switch (opcode & 0x7F) {
+        case LOAD:
+        case MISCMEM:
+        case JALR:
+            instruction.imm = static_cast<std::int32_t>(opcode) >> 20;
+            break;
+
+        case OPIMM:
+        case OPIMM32:
+            instruction.imm = static_cast<std::int32_t>(opcode) >> 20;
+
+            // SRAI and SRAIW share funct3 101 with the logical shifts, bit 30 tells them apart
+            if ((opcode >> 30) & 0x1) {
+                if (instruction.op == Op::Srli) {
+                    instruction.op = Op::Srai;
+                } else if (instruction.op == Op::Srliw) {
+                    instruction.op = Op::Sraiw;
+                }
+            }
+            break;
+
+        case STORE:
+            instruction.imm = ((static_cast<std::int32_t>(opcode) >> 25) << 5) | ((opcode >> 7) & 0x1F);
+            break;
+
+        case BRANCH:
+            instruction.imm = ((static_cast<std::int32_t>(opcode) >> 31) << 12) | (((opcode >> 7) & 0x1) << 11) |
+                              (((opcode >> 25) & 0x3F) << 5) | (((opcode >> 8) & 0xF) << 1);
+            break;
+
+        case AUIPC:
+        case LUI:
+            instruction.imm = static_cast<std::int32_t>(opcode & 0xFFFFF000);
+            break;
+
+        case JAL:
+            instruction.imm = ((static_cast<std::int32_t>(opcode) >> 31) << 20) | (opcode & 0xFF000) |
+                              (((opcode >> 20) & 0x1) << 11) | (((opcode >> 21) & 0x3FF) << 1);
+            break;
+
+        case SYSTEM:
+            instruction.imm = static_cast<std::int32_t>(opcode) >> 20;
+
+            if (funct3 == 0b000) {
+                switch (opcode >> 20) {
+                    case 0x000: instruction.op = Op::Ecall; break;
+                    case 0x001: instruction.op = Op::Ebreak; break;
+                    case 0x105: instruction.op = Op::Wfi; break;
+                    default: instruction.op = Op::Illegal; break;
+                }
+            }
+            break;
+
+        case OP: {
+            std::uint8_t row = op_funct7_rows[(opcode >> 25) & 0x7F];
+            instruction.imm = 0;
+            instruction.op = op_table[row][funct3];
+            break;
+        }
+
+        case OP32: {
+            std::uint8_t row = op_funct7_rows[(opcode >> 25) & 0x7F];
+            instruction.imm = 0;
+            instruction.op = op32_table[row][funct3];
+            break;
+        }
+
+        case AMO:
+            instruction.imm = 0;
+            instruction.op = (funct3 == 0b010 || !HAS_A) ? amo_table[opcode >> 27] : Op::IllegalAmo;
+            break;
+
+        default:
+            instruction.imm = 0;
+            break;
+    }
+
+    if (enabled_extensions != extensions) {
+        instruction.op = disable_missing_extension(instruction.op, opcode);
+    }
+
+    if constexpr (is_embedded) {
+        if (uses_missing_register(opcode)) {
+            instruction.op = Op::Illegal;
+        }
+    }
+
+    instruction.handler = handler_table[static_cast<std::size_t>(instruction.op)];
+
+    return instruction;
+}
+
+// Same mapping the tables apply for extensions left out of the mask, for the ones the core turned off
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+typename Interpreter<xlen, is_embedded, extensions>::Op Interpreter<xlen, is_embedded, extensions>::disable_missing_extension(Op op, std::uint32_t opcode) const {
+    switch (opcode & 0x7F) {
+        case OP:
+            if (!(enabled_extensions & InterpreterExtension::M) && (opcode >> 25) == 0x01) {
+                return Op::MUnavailable;
+            }
+            break;
+
+        case AMO:
+            if (!(enabled_extensions & InterpreterExtension::A)) {
+                return Op::AUnavailable;
+            }
+            break;
+
+        case MISCMEM:
+            if (!(enabled_extensions & InterpreterExtension::Zifencei) && op == Op::FenceI) {
+                return Op::ZifenceiUnavailable;
+            }
+            break;
+
+        case SYSTEM:
+            if (!(enabled_extensions & InterpreterExtension::Zicsr) && op >= Op::Csrrw && op <= Op::Csrrci) {
+                return Op::ZicsrUnavailable;
+            }
+            break;
+    }
+
+    return op;
+}
+
+// RV32E only has x0-x15; fields an encoding doesn't use as registers may hold anything
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+bool Interpreter<xlen, is_embedded, extensions>::uses_missing_register(std::uint32_t opcode) {
+    std::uint8_t rd = (opcode >> 7) & 0x1F;
+    std::uint8_t rs1 = (opcode >> 15) & 0x1F;
+    std::uint8_t rs2 = (opcode >> 20) & 0x1F;
+    std::uint8_t used;
+
+    switch (opcode & 0x7F) {
+        case AUIPC:
+        case LUI:
+        case JAL:
+            used = rd;
+            break;
+
+        case STORE:
+        case BRANCH:
+            used = rs1 | rs2;
+            break;
+
+        case OP:
+        case OP32:
+        case AMO:
+            used = rd | rs1 | rs2;
+            break;
+
+        case SYSTEM:
+            // The CSR immediate forms carry a uimm in rs1
+            used = (opcode & (0b100 << 12)) ? rd : (rd | rs1);
+            break;
+
+        default:
+            used = rd | rs1;
+            break;
+    }
+
+    return used >= REGISTER_COUNT;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+inline const typename Interpreter<xlen, is_embedded, extensions>::DecodedInstruction& Interpreter<xlen, is_embedded, extensions>::fetch_decoded(reg_t pc) {
+    // Misaligned PCs would alias another slot of the page, decode them every time
+    if ((pc & ~static_cast<reg_t>(CODE_PAGE_SIZE - 1 - 3)) != current_page_base) {
+        if (pc & 3) {
+            uncached_instruction = decode(core->fetch_opcode(pc));
+            return uncached_instruction;
+        }
+
+        switch_page(pc);
+    }
+
+    return current_page->entries[(pc & (CODE_PAGE_SIZE - 1)) >> 2];
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::switch_page(reg_t pc) {
+    reg_t page_base = pc & ~static_cast<reg_t>(CODE_PAGE_SIZE - 1);
+    auto& page = decoded_pages[page_base];
+
+    if (!page) {
+        page = std::make_unique<DecodedPage>();
+        reset_page(*page);
+    }
+
+    current_page = page.get();
+    current_page_base = page_base;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::reset_page(DecodedPage& page) {
+    DecodedInstruction pending{};
+    pending.op = Op::Decode;
+    pending.handler = &Interpreter::decode_and_execute;
+    page.entries.fill(pending);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::flush_decoded_pages() {
+    for (auto& [page_base, page] : decoded_pages) {
+        reset_page(*page);
+    }
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+const typename Interpreter<xlen, is_embedded, extensions>::DecodedInstruction& Interpreter<xlen, is_embedded, extensions>::decode_slot(const DecodedInstruction& instruction) {
+    // Op::Decode is only ever installed in page slots owned by this interpreter
+    auto& slot = const_cast<DecodedInstruction&>(instruction);
+
+    core->bus.mark_code_page(core->pc);
+    slot = decode(core->fetch_opcode());
+    try_fuse(slot, core->pc);
+
+    return slot;
+}
+
+/*
+ * Folds the common two-instruction idioms (constant materialisation, far
+ * calls, PC-relative loads and set-then-branch) into a single slot. Only the
+ * first slot changes, the second one still decodes normally so jumping
+ * straight to it keeps working.
+ */
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::try_fuse(DecodedInstruction& first, reg_t pc) {
+    // Both halves must share a page so a single invalidation covers the pair,
+    // and writes to x0 must still be discarded in between
+    if ((pc & (CODE_PAGE_SIZE - 1)) == CODE_PAGE_SIZE - 4 || first.rd == 0) {
+        return;
+    }
+
+    if (first.op != Op::Lui && first.op != Op::Auipc && first.op != Op::Sltu && first.op != Op::Sltiu) {
+        return;
+    }
+
+    // The second half is never an EBREAK, which is the only breakpoint there
+    // is, and patching one in invalidates the page and with it this slot
+    DecodedInstruction second = decode(core->fetch_opcode(pc + 4));
+    bool branch_on_rd = (second.op == Op::Bne || second.op == Op::Beq) && second.rs1 == first.rd && second.rs2 == 0;
+
+    switch (first.op) {
+        case Op::Lui:
+            if (second.op == Op::Addi && second.rd == first.rd && second.rs1 == first.rd) {
+                std::int64_t value = static_cast<std::int64_t>(first.imm) + second.imm;
+
+                // RV32 wraps, on RV64 the sum has to survive sign extension from imm
+                if (IS_RV64 && value != static_cast<std::int32_t>(value)) {
+                    break;
+                }
+
+                first.op = Op::LuiAddi;
+                first.imm = static_cast<std::int32_t>(value);
+            }
+            break;
+
+        case Op::Auipc:
+            if ((second.op == Op::Jalr || second.op == Op::Lw) && second.rs1 == first.rd) {
+                // The slot is tied to this PC, so the AUIPC result is a constant;
+                // it's kept as the low 32 bits, which is all RV64 can use here too
+                reg_t base = pc + first.imm;
+
+                if (base > 0xFFFFFFFF) {
+                    break;
+                }
+
+                first.op = (second.op == Op::Jalr) ? Op::AuipcJalr : Op::AuipcLw;
+                first.imm = static_cast<std::int32_t>(base);
+                first.fused_imm = second.imm;
+                first.rs2 = second.rd;
+            }
+            break;
+
+        case Op::Sltu:
+        case Op::Sltiu:
+            if (branch_on_rd) {
+                bool is_bne = second.op == Op::Bne;
+
+                if (first.op == Op::Sltu) {
+                    first.op = is_bne ? Op::SltuBnez : Op::SltuBeqz;
+                } else {
+                    first.op = is_bne ? Op::SltiuBnez : Op::SltiuBeqz;
+                }
+
+                first.fused_imm = second.imm;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    first.handler = handler_table[static_cast<std::size_t>(first.op)];
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+std::vector<std::pair<std::string, std::uint64_t>> Interpreter<xlen, is_embedded, extensions>::get_fusion_stats() const {
+    static const char* const names[FUSED_OP_COUNT] = {
+        "lui + addi",
+        "auipc + jalr",
+        "auipc + lw",
+        "sltu + bnez",
+        "sltu + beqz",
+        "sltiu + bnez",
+        "sltiu + beqz",
+    };
+
+    std::vector<std::pair<std::string, std::uint64_t>> stats;
+
+    for (std::size_t i = 0; i < FUSED_OP_COUNT; i++) {
+        stats.emplace_back(names[i], fusion_counts[i].load(std::memory_order_relaxed));
+    }
+
+    return stats;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::decode_and_execute(const DecodedInstruction& instruction) {
+    const DecodedInstruction& slot = decode_slot(instruction);
+    (this->*slot.handler)(slot);
+}
+
+/*
+ * Direct-threaded execution: every handler body is inlined behind its own
+ * label and ends with its own indirect jump to the next instruction, so the
+ * host predictor sees one dispatch site per guest opcode instead of the
+ * single, constantly mispredicted call in step().
+ */
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+ExitReason Interpreter<xlen, is_embedded, extensions>::run_threaded(std::uint64_t budget) {
+    static void* const labels[] = {
+        &&op_decode,
+        &&op_illegal,
+        &&op_illegal_op,
+        &&op_illegal_amo,
+        &&op_m_unavailable,
+        &&op_a_unavailable,
+        &&op_zicsr_unavailable,
+        &&op_zifencei_unavailable,
+        &&op_auipc,
+        &&op_lui,
+        &&op_jal,
+        &&op_jalr,
+        &&op_lb,
+        &&op_lw,
+        &&op_lbu,
+        &&op_lh,
+        &&op_lhu,
+        &&op_sub,
+        &&op_add,
+        &&op_sll,
+        &&op_sltu,
+        &&op_xor,
+        &&op_or,
+        &&op_and,
+        &&op_slt,
+        &&op_srl,
+        &&op_sra,
+        HAS_M ? &&op_mul : &&op_m_unavailable,
+        HAS_M ? &&op_mulhu : &&op_m_unavailable,
+        HAS_M ? &&op_div : &&op_m_unavailable,
+        HAS_M ? &&op_mulh : &&op_m_unavailable,
+        HAS_M ? &&op_mulhsu : &&op_m_unavailable,
+        HAS_M ? &&op_divu : &&op_m_unavailable,
+        HAS_M ? &&op_rem : &&op_m_unavailable,
+        HAS_M ? &&op_remu : &&op_m_unavailable,
+        HAS_ZICSR ? &&op_csrrw : &&op_zicsr_unavailable,
+        HAS_ZICSR ? &&op_csrrs : &&op_zicsr_unavailable,
+        HAS_ZICSR ? &&op_csrrc : &&op_zicsr_unavailable,
+        HAS_ZICSR ? &&op_csrrsi : &&op_zicsr_unavailable,
+        HAS_ZICSR ? &&op_csrrwi : &&op_zicsr_unavailable,
+        HAS_ZICSR ? &&op_csrrci : &&op_zicsr_unavailable,
+        HAS_ZIFENCEI ? &&op_fence_i : &&op_zifencei_unavailable,
+        &&op_fence,
+        &&op_ecall,
+        &&op_ebreak,
+        &&op_wfi,
+        &&op_addi,
+        &&op_slli,
+        &&op_sltiu,
+        &&op_srli,
+        &&op_srai,
+        &&op_andi,
+        &&op_slti,
+        &&op_xori,
+        &&op_ori,
+        &&op_beq,
+        &&op_bne,
+        &&op_blt,
+        &&op_bge,
+        &&op_bltu,
+        &&op_bgeu,
+        &&op_sb,
+        &&op_sw,
+        &&op_sh,
+        HAS_A ? &&op_amoor_w : &&op_a_unavailable,
+        HAS_A ? &&op_amoadd_w : &&op_a_unavailable,
+        HAS_A ? &&op_amoswap_w : &&op_a_unavailable,
+        HAS_A ? &&op_amoxor_w : &&op_a_unavailable,
+        HAS_A ? &&op_amoand_w : &&op_a_unavailable,
+        HAS_A ? &&op_amomin_w : &&op_a_unavailable,
+        HAS_A ? &&op_amomax_w : &&op_a_unavailable,
+        HAS_A ? &&op_amominu_w : &&op_a_unavailable,
+        HAS_A ? &&op_amomaxu_w : &&op_a_unavailable,
+        HAS_A ? &&op_lr_w : &&op_a_unavailable,
+        HAS_A ? &&op_sc_w : &&op_a_unavailable,
+        IS_RV64 ? &&op_ld : &&op_illegal,
+        IS_RV64 ? &&op_lwu : &&op_illegal,
+        IS_RV64 ? &&op_sd : &&op_illegal,
+        IS_RV64 ? &&op_addiw : &&op_illegal,
+        IS_RV64 ? &&op_slliw : &&op_illegal,
+        IS_RV64 ? &&op_srliw : &&op_illegal,
+        IS_RV64 ? &&op_sraiw : &&op_illegal,
+        IS_RV64 ? &&op_addw : &&op_illegal,
+        IS_RV64 ? &&op_subw : &&op_illegal,
+        &&op_lui_addi,
+        &&op_auipc_jalr,
+        &&op_auipc_lw,
+        &&op_sltu_bnez,
+        &&op_sltu_beqz,
+        &&op_sltiu_bnez,
+        &&op_sltiu_beqz,
+    };
+
+    static_assert(sizeof(labels) / sizeof(labels[0]) == HANDLER_TABLE_SIZE, "Threaded label table out of sync with Op");
+
+    const DecodedInstruction* instruction = &fetch_decoded(core->pc);
+    DecodedInstruction first_half;
+
+#define DISPATCH()                                                      \
+    core->registers[0] = 0;                                             \
+    core->pc += 4;                                                      \
+    if (--budget == 0 || exit_requested) {                              \
+        return take_exit_reason();                                      \
+    }                                                                   \
+    instruction = &fetch_decoded(core->pc);                             \
+    goto *labels[static_cast<std::size_t>(instruction->op)]
+
+#define HANDLER(label, handler)                                         \
+    label:                                                              \
+        handler(*instruction);                                          \
+        DISPATCH();
+
+// A fused pair retires two instructions and is charged for both, with a
+// single one left in the budget only its first half runs
+#define FUSED_HANDLER(label, handler)                                   \
+    label:                                                              \
+        if (budget == 1) {                                              \
+            goto split_pair;                                            \
+        }                                                               \
+        budget--;                                                       \
+        handler(*instruction);                                          \
+        DISPATCH();
+
+    goto *labels[static_cast<std::size_t>(instruction->op)];
+
+split_pair:
+    first_half = decode(core->fetch_opcode());
+    instruction = &first_half;
+    goto *labels[static_cast<std::size_t>(instruction->op)];
+
+op_decode:
+    // Decoding doesn't retire anything, run the freshly decoded slot
+    instruction = &decode_slot(*instruction);
+    goto *labels[static_cast<std::size_t>(instruction->op)];
+
+    HANDLER(op_illegal, illegal_instruction)
+    HANDLER(op_illegal_op, illegal_op)
+    HANDLER(op_illegal_amo, illegal_amo)
+    HANDLER(op_m_unavailable, m_unavailable)
+    HANDLER(op_a_unavailable, a_unavailable)
+    HANDLER(op_zicsr_unavailable, zicsr_unavailable)
+    HANDLER(op_zifencei_unavailable, zifencei_unavailable)
+    HANDLER(op_auipc, rv32i_auipc)
+    HANDLER(op_lui, rv32i_lui)
+    HANDLER(op_jal, rv32i_jal)
+    HANDLER(op_jalr, rv32i_jalr)
+    HANDLER(op_lb, rv32i_lb)
+    HANDLER(op_lw, rv32i_lw)
+    HANDLER(op_lbu, rv32i_lbu)
+    HANDLER(op_lh, rv32i_lh)
+    HANDLER(op_lhu, rv32i_lhu)
+    HANDLER(op_sub, rv32i_sub)
+    HANDLER(op_add, rv32i_add)
+    HANDLER(op_sll, rv32i_sll)
+    HANDLER(op_sltu, rv32i_sltu)
+    HANDLER(op_xor, rv32i_xor)
+    HANDLER(op_or, rv32i_or)
+    HANDLER(op_and, rv32i_and)
+    HANDLER(op_slt, rv32i_slt)
+    HANDLER(op_srl, rv32i_srl)
+    HANDLER(op_sra, rv32i_sra)
+    HANDLER(op_mul, rv32i_mul)
+    HANDLER(op_mulhu, rv32i_mulhu)
+    HANDLER(op_div, rv32i_div)
+    HANDLER(op_mulh, rv32i_mulh)
+    HANDLER(op_mulhsu, rv32i_mulhsu)
+    HANDLER(op_divu, rv32i_divu)
+    HANDLER(op_rem, rv32i_rem)
+    HANDLER(op_remu, rv32i_remu)
+    HANDLER(op_csrrw, rv32i_csrrw)
+    HANDLER(op_csrrs, rv32i_csrrs)
+    HANDLER(op_csrrc, rv32i_csrrc)
+    HANDLER(op_csrrsi, rv32i_csrrsi)
+    HANDLER(op_csrrwi, rv32i_csrrwi)
+    HANDLER(op_csrrci, rv32i_csrrci)
+    HANDLER(op_fence_i, rv32i_fence_i)
+    HANDLER(op_fence, rv32i_fence)
+    HANDLER(op_ecall, rv32i_ecall)
+    HANDLER(op_ebreak, rv32i_ebreak)
+    HANDLER(op_wfi, rv32i_wfi)
+    HANDLER(op_addi, rv32i_addi)
+    HANDLER(op_slli, rv32i_slli)
+    HANDLER(op_sltiu, rv32i_sltiu)
+    HANDLER(op_srli, rv32i_srli)
+    HANDLER(op_srai, rv32i_srai)
+    HANDLER(op_andi, rv32i_andi)
+    HANDLER(op_slti, rv32i_slti)
+    HANDLER(op_xori, rv32i_xori)
+    HANDLER(op_ori, rv32i_ori)
+    HANDLER(op_beq, rv32i_beq)
+    HANDLER(op_bne, rv32i_bne)
+    HANDLER(op_blt, rv32i_blt)
+    HANDLER(op_bge, rv32i_bge)
+    HANDLER(op_bltu, rv32i_bltu)
+    HANDLER(op_bgeu, rv32i_bgeu)
+    HANDLER(op_sb, rv32i_sb)
+    HANDLER(op_sw, rv32i_sw)
+    HANDLER(op_sh, rv32i_sh)
+    HANDLER(op_amoor_w, rv32i_amoor_w)
+    HANDLER(op_amoadd_w, rv32i_amoadd_w)
+    HANDLER(op_amoswap_w, rv32i_amoswap_w)
+    HANDLER(op_amoxor_w, rv32i_amoxor_w)
+    HANDLER(op_amoand_w, rv32i_amoand_w)
+    HANDLER(op_amomin_w, rv32i_amomin_w)
+    HANDLER(op_amomax_w, rv32i_amomax_w)
+    HANDLER(op_amominu_w, rv32i_amominu_w)
+    HANDLER(op_amomaxu_w, rv32i_amomaxu_w)
+    HANDLER(op_lr_w, rv32i_lr_w)
+    HANDLER(op_sc_w, rv32i_sc_w)
+    HANDLER(op_ld, rv64i_ld)
+    HANDLER(op_lwu, rv64i_lwu)
+    HANDLER(op_sd, rv64i_sd)
+    HANDLER(op_addiw, rv64i_addiw)
+    HANDLER(op_slliw, rv64i_slliw)
+    HANDLER(op_srliw, rv64i_srliw)
+    HANDLER(op_sraiw, rv64i_sraiw)
+    HANDLER(op_addw, rv64i_addw)
+    HANDLER(op_subw, rv64i_subw)
+    FUSED_HANDLER(op_lui_addi, fused_lui_addi)
+    FUSED_HANDLER(op_auipc_jalr, fused_auipc_jalr)
+    FUSED_HANDLER(op_auipc_lw, fused_auipc_lw)
+    FUSED_HANDLER(op_sltu_bnez, fused_sltu_bnez)
+    FUSED_HANDLER(op_sltu_beqz, fused_sltu_beqz)
+    FUSED_HANDLER(op_sltiu_bnez, fused_sltiu_bnez)
+    FUSED_HANDLER(op_sltiu_beqz, fused_sltiu_beqz)
+
+#undef FUSED_HANDLER
+#undef HANDLER
+#undef DISPATCH
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::code_written(std::uint32_t address) {
+    auto it = decoded_pages.find(address & ~static_cast<reg_t>(CODE_PAGE_SIZE - 1));
+    if (it != decoded_pages.end()) {
+        reset_page(*it->second);
+    }
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::illegal_instruction(const DecodedInstruction& instruction) {
+    unknown_rv32_opcode(instruction.opcode);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::illegal_op(const DecodedInstruction& instruction) {
+    unknown_op_opcode((instruction.opcode >> 12) & 0x7, (instruction.opcode >> 25) & 0x7F);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::illegal_amo(const DecodedInstruction& instruction) {
+    unknown_amo_opcode((instruction.opcode >> 12) & 0x7, (instruction.opcode >> 25) & 0x7F);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::m_unavailable(const DecodedInstruction&) {
+    no_ext("M");
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::a_unavailable(const DecodedInstruction&) {
+    no_ext("A");
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::zicsr_unavailable(const DecodedInstruction&) {
+    no_ext("Zicsr");
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::zifencei_unavailable(const DecodedInstruction&) {
+    no_ext("Zifencei");
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::no_ext(std::string extension) {
+	std::ostringstream logMessage;
+	logMessage << "FATAL ERROR: Called a " << extension.c_str() << " extension opcode but it's unavailable for this core!";
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_rv16_opcode(std::uint16_t opcode) {
+    std::ostringstream logMessage;
+    logMessage << "Unimplemented RV16 Opcode: 0x" << format("{:04X}", opcode);
+
+    Logger::error(logMessage.str());
+
+    Risky::exit(1, Risky::Subsystem::Core);
+    request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_rv32_opcode(std::uint32_t opcode) {
+    std::ostringstream logMessage;
+    logMessage << "Unimplemented RV32 Opcode: 0x" << format("{:08X}", opcode);
+
+    Logger::error(logMessage.str());
+
+    Risky::exit(1, Risky::Subsystem::Core);
+    request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_zicsr_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented Zicsr opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_load_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented LOAD opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_miscmem_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented MISC-MEM opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_branch_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented BRANCH opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_store_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented STORE opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_amo_opcode(std::uint8_t funct3, std::uint8_t funct7) {
+    std::ostringstream logMessage;
+    logMessage << "Unimplemented AMO opcode: funct3=0b" << std::bitset<3>(funct3)
+               << ", funct7=0b" << std::bitset<7>(funct7);
+
+    Logger::error(logMessage.str());
+
+    Risky::exit(1, Risky::Subsystem::Core);
+    request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_op_opcode(std::uint8_t funct3, std::uint8_t funct7) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented OP opcode: funct3=0b" << std::bitset<3>(funct3)
+	           << ", funct7=0b" << std::bitset<7>(funct7);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_immediate_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented OP-IMM opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+	request_exit(ExitReason::Error);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::unknown_compressed_opcode(std::uint8_t funct3) {
+    std::ostringstream logMessage;
+    logMessage << "Unimplemented Compressed opcode: 0b" << format("{:08b}", funct3);
+
+    Logger::error(logMessage.str());
+
+    Risky::exit(1, Risky::Subsystem::Core);
+    request_exit(ExitReason::Error);
+}
+
+// RV16
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_caddi(std::uint16_t opcode) {
+    std::uint8_t rd = ((opcode >> 7) & 0x7);
+    std::uint8_t imm = ((opcode >> 2) & 0x1F);
+
+    if (imm == 0) {
+        // C.NOP
+        return;
+    }
+
+    std::int32_t imm32 = static_cast<std::int32_t>(imm << 26) >> 26;
+    std::int32_t result = core->registers[rd] + imm32;
+
+    core->registers[rd] = result;
+}
+
+// AIUPC
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_auipc(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+
+	reg_t result = core->pc + instruction.imm;
+
+	core->registers[rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lui(const DecodedInstruction& instruction) {
+	core->registers[instruction.rd] = static_cast<reg_t>(instruction.imm);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_jal(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+	std::int32_t imm = instruction.imm;
+
+	core->registers[rd] = core->pc + 4;
+
+	core->pc += imm - 4;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_jalr(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+	std::uint8_t rs1 = instruction.rs1;
+
+	reg_t temp = core->pc + 4;
+
+	reg_t target_address = (core->registers[rs1] + instruction.imm) & ~static_cast<reg_t>(1);
+
+	core->pc = target_address - 4;
+
+	core->registers[rd] = temp;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lb(const DecodedInstruction& instruction) {
+    std::uint8_t rd = instruction.rd;
+
+    uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+    int8_t loaded_value = core->bus.read8(effective_address);
+
+    reg_t sign_extended_value = static_cast<sreg_t>(loaded_value);
+
+    core->registers[rd] = sign_extended_value;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lw(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	uint32_t loaded_value = core->bus.read32(effective_address);
+
+	core->registers[rd] = static_cast<reg_t>(static_cast<std::int32_t>(loaded_value));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lbu(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	uint8_t loaded_byte = core->bus.read8(effective_address);
+
+	core->registers[rd] = static_cast<reg_t>(loaded_byte);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lh(const DecodedInstruction& instruction) {
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	auto loaded_value = static_cast<std::int16_t>(core->bus.read8(effective_address) | (core->bus.read8(effective_address + 1) << 8));
+
+	core->registers[instruction.rd] = static_cast<reg_t>(static_cast<sreg_t>(loaded_value));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lhu(const DecodedInstruction& instruction) {
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	auto loaded_value = static_cast<std::uint16_t>(core->bus.read8(effective_address) | (core->bus.read8(effective_address + 1) << 8));
+
+	core->registers[instruction.rd] = static_cast<reg_t>(loaded_value);
+}
+
+// OP
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sub(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] - core->registers[instruction.rs2];
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_add(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] + core->registers[instruction.rs2];
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sll(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] << (core->registers[instruction.rs2] & (xlen - 1));
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sltu(const DecodedInstruction& instruction) {
+    reg_t result = (core->registers[instruction.rs1] < core->registers[instruction.rs2]) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_xor(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] ^ core->registers[instruction.rs2];
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_or(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] | core->registers[instruction.rs2];
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_and(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] & core->registers[instruction.rs2];
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_slt(const DecodedInstruction& instruction) {
+    reg_t result = (static_cast<sreg_t>(core->registers[instruction.rs1]) < static_cast<sreg_t>(core->registers[instruction.rs2])) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_srl(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] >> (core->registers[instruction.rs2] & (xlen - 1));
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sra(const DecodedInstruction& instruction) {
+    reg_t result = static_cast<reg_t>(static_cast<sreg_t>(core->registers[instruction.rs1]) >> (core->registers[instruction.rs2] & (xlen - 1)));
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_mul(const DecodedInstruction& instruction) {
+    reg_t result = core->registers[instruction.rs1] * core->registers[instruction.rs2];
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_mulhu(const DecodedInstruction& instruction) {
+    dreg_t result = static_cast<dreg_t>(core->registers[instruction.rs1]) * static_cast<dreg_t>(core->registers[instruction.rs2]);
+
+    core->registers[instruction.rd] = static_cast<reg_t>(result >> xlen);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_div(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+
+	sreg_t dividend = static_cast<sreg_t>(core->registers[instruction.rs1]);
+	sreg_t divisor = static_cast<sreg_t>(core->registers[instruction.rs2]);
+
+	if (divisor == 0) {
+		core->registers[rd] = -1;
+	} else if (dividend == std::numeric_limits<sreg_t>::min() && divisor == -1) {
+		core->registers[rd] = dividend;
+	} else {
+		core->registers[rd] = dividend / divisor;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_mulh(const DecodedInstruction& instruction) {
+    sdreg_t result = static_cast<sdreg_t>(static_cast<sreg_t>(core->registers[instruction.rs1])) *
+                     static_cast<sdreg_t>(static_cast<sreg_t>(core->registers[instruction.rs2]));
+
+    core->registers[instruction.rd] = static_cast<reg_t>(result >> xlen);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_mulhsu(const DecodedInstruction& instruction) {
+    // rs2 is zero-extended, the product of a signed XLEN and an unsigned XLEN value still fits
+    sdreg_t result = static_cast<sdreg_t>(static_cast<sreg_t>(core->registers[instruction.rs1])) *
+                     static_cast<sdreg_t>(core->registers[instruction.rs2]);
+
+    core->registers[instruction.rd] = static_cast<reg_t>(result >> xlen);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_divu(const DecodedInstruction& instruction) {
+	reg_t dividend = core->registers[instruction.rs1];
+	reg_t divisor = core->registers[instruction.rs2];
+
+	core->registers[instruction.rd] = divisor == 0 ? std::numeric_limits<reg_t>::max() : dividend / divisor;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_rem(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+
+	sreg_t dividend = static_cast<sreg_t>(core->registers[instruction.rs1]);
+	sreg_t divisor = static_cast<sreg_t>(core->registers[instruction.rs2]);
+
+	if (divisor == 0) {
+		core->registers[rd] = dividend;
+	} else if (dividend == std::numeric_limits<sreg_t>::min() && divisor == -1) {
+		core->registers[rd] = 0;
+	} else {
+		core->registers[rd] = dividend % divisor;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_remu(const DecodedInstruction& instruction) {
+	reg_t dividend = core->registers[instruction.rs1];
+	reg_t divisor = core->registers[instruction.rs2];
+
+	core->registers[instruction.rd] = divisor == 0 ? dividend : dividend % divisor;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_csrrw(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+	std::uint8_t rs1 = instruction.rs1;
+	std::uint16_t csr = instruction.imm & 0xFFF;
+	reg_t value = core->registers[rs1];
+	core->registers[rd] = core->csr_read(csr);
+	core->csr_write(csr, value);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_csrrs(const DecodedInstruction& instruction) {
+	std::uint8_t rs1 = instruction.rs1;
+	std::uint16_t csr = instruction.imm & 0xFFF;
+
+	reg_t old_csr_value = core->csr_read(csr);
+	reg_t bit_mask = core->registers[rs1];
+
+	// With x0 as the source CSRRS only reads
+	if (rs1 != 0) {
+		core->csr_write(csr, old_csr_value | bit_mask);
+	}
+
+	core->registers[instruction.rd] = old_csr_value;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_csrrc(const DecodedInstruction& instruction) {
+	std::uint8_t rs1 = instruction.rs1;
+	std::uint16_t csr = instruction.imm & 0xFFF;
+
+	reg_t old_csr_value = core->csr_read(csr);
+	reg_t mask = core->registers[rs1];
+
+	if (rs1 != 0) {
+		core->csr_write(csr, old_csr_value & ~mask);
+	}
+
+	core->registers[instruction.rd] = old_csr_value;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_csrrsi(const DecodedInstruction& instruction) {
+	std::uint8_t uimm = instruction.rs1;
+	std::uint16_t csr = instruction.imm & 0xFFF;
+
+	reg_t old_csr_value = core->csr_read(csr);
+
+	// A zero immediate only reads, same as x0 for CSRRS
+	if (uimm != 0) {
+		core->csr_write(csr, old_csr_value | uimm);
+	}
+
+	core->registers[instruction.rd] = old_csr_value;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_csrrci(const DecodedInstruction& instruction) {
+	std::uint8_t uimm = instruction.rs1;
+	std::uint16_t csr = instruction.imm & 0xFFF;
+
+	reg_t old_csr_value = core->csr_read(csr);
+
+	if (uimm != 0) {
+		core->csr_write(csr, old_csr_value & ~static_cast<reg_t>(uimm));
+	}
+
+	core->registers[instruction.rd] = old_csr_value;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_csrrwi(const DecodedInstruction& instruction) {
+	std::uint8_t rd = instruction.rd;
+	std::uint8_t uimm = instruction.rs1;
+	std::uint16_t csr = instruction.imm & 0xFFF;
+
+	reg_t old_csr_value = core->csr_read(csr);
+
+	if (rd != 0) {
+		core->registers[rd] = old_csr_value;
+	}
+
+	core->csr_write(csr, uimm);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_fence_i(const DecodedInstruction&) {
+	/*
+	 * Stores already invalidate the pages they hit, but fence.i is the
+	 * architectural point where the guest asks for a coherent instruction
+	 * stream. The bus hands it to every backend registered on it, so this
+	 * one, the JIT running us as its fallback and any other hart on the same
+	 * bus all drop what they decoded from RAM. Pages outside RAM aren't
+	 * tracked there, so ours are flushed directly as well.
+	 */
+	core->bus.invalidate_code_pages();
+	flush_decoded_pages();
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_fence(const DecodedInstruction&) {
+	// Loads and stores already reach the bus in program order, there's nothing to order
+}
+
+/*
+ * There's no trap delivery yet, so the environment instructions retire and
+ * then hand control back to whoever called run(); resuming continues after them.
+ */
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_ecall(const DecodedInstruction&) {
+	request_exit(ExitReason::Trap);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_ebreak(const DecodedInstruction&) {
+	request_exit(ExitReason::Breakpoint);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_wfi(const DecodedInstruction&) {
+	// Nothing can raise an interrupt yet, so waiting for one never ends
+	request_exit(ExitReason::Halt);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_addi(const DecodedInstruction& instruction) {
+	core->registers[instruction.rd] = core->registers[instruction.rs1] + instruction.imm;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_slli(const DecodedInstruction& instruction) {
+    std::uint8_t shamt = instruction.imm & (xlen - 1);
+
+    reg_t result = core->registers[instruction.rs1] << shamt;
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sltiu(const DecodedInstruction& instruction) {
+    auto imm = static_cast<reg_t>(instruction.imm);
+
+    reg_t result = (core->registers[instruction.rs1] < imm) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_srli(const DecodedInstruction& instruction) {
+    std::uint8_t shamt = instruction.imm & (xlen - 1);
+
+    reg_t result = core->registers[instruction.rs1] >> shamt;
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_srai(const DecodedInstruction& instruction) {
+    std::uint8_t shamt = instruction.imm & (xlen - 1);
+
+    reg_t result = static_cast<reg_t>(static_cast<sreg_t>(core->registers[instruction.rs1]) >> shamt);
+
+    core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_andi(const DecodedInstruction& instruction) {
+	reg_t result = core->registers[instruction.rs1] & instruction.imm;
+
+	core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_slti(const DecodedInstruction& instruction) {
+	reg_t result = (static_cast<sreg_t>(core->registers[instruction.rs1]) < static_cast<sreg_t>(instruction.imm)) ? 1 : 0;
+
+	core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_xori(const DecodedInstruction& instruction) {
+	reg_t result = core->registers[instruction.rs1] ^ static_cast<reg_t>(instruction.imm);
+
+	core->registers[instruction.rd] = result;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_ori(const DecodedInstruction& instruction) {
+	reg_t result = core->registers[instruction.rs1] | static_cast<reg_t>(instruction.imm);
+
+	core->registers[instruction.rd] = result;
+}
+
+// BRANCH
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_beq(const DecodedInstruction& instruction) {
+	if (core->registers[instruction.rs1] == core->registers[instruction.rs2]) {
+		core->pc += instruction.imm - 4;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_bne(const DecodedInstruction& instruction) {
+	if (core->registers[instruction.rs1] != core->registers[instruction.rs2]) {
+		core->pc += instruction.imm - 4;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_blt(const DecodedInstruction& instruction) {
+	if (static_cast<sreg_t>(core->registers[instruction.rs1]) < static_cast<sreg_t>(core->registers[instruction.rs2])) {
+		core->pc += instruction.imm - 4;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_bge(const DecodedInstruction& instruction) {
+	if (static_cast<sreg_t>(core->registers[instruction.rs1]) >= static_cast<sreg_t>(core->registers[instruction.rs2])) {
+		core->pc += instruction.imm - 4;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_bltu(const DecodedInstruction& instruction) {
+	if (core->registers[instruction.rs1] < core->registers[instruction.rs2]) {
+		core->pc += instruction.imm - 4;
+	}
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_bgeu(const DecodedInstruction& instruction) {
+	if (core->registers[instruction.rs1] >= core->registers[instruction.rs2]) {
+		core->pc += instruction.imm - 4;
+	}
+}
+
+// STORE
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sb(const DecodedInstruction& instruction) {
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	core->bus.write8(effective_address, core->registers[instruction.rs2] & 0xFF);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sw(const DecodedInstruction& instruction) {
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	core->bus.write32(effective_address, core->registers[instruction.rs2]);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sh(const DecodedInstruction& instruction) {
+	uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+	reg_t value = core->registers[instruction.rs2];
+
+	core->bus.write8(effective_address, value & 0xFF);
+	core->bus.write8(effective_address + 1, (value >> 8) & 0xFF);
+}
+
+// AMO
+// Reads the word at rs1, stores combine(word, rs2) back and returns the old word in rd
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+template <typename Combine>
+void Interpreter<xlen, is_embedded, extensions>::amo_w(const DecodedInstruction& instruction, Combine combine) {
+    std::uint32_t address = core->registers[instruction.rs1];
+    std::uint32_t value = core->bus.read32(address);
+    std::uint32_t word = combine(value, static_cast<std::uint32_t>(core->registers[instruction.rs2]));
+    core->bus.write32(address, word);
+
+    // .W results are sign-extended on RV64
+    core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(value));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amoor_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) { return value | src; });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amoadd_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) { return value + src; });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amoswap_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t, std::uint32_t src) { return src; });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amoxor_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) { return value ^ src; });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amoand_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) { return value & src; });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amomin_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) {
+        return static_cast<std::int32_t>(value) < static_cast<std::int32_t>(src) ? value : src;
+    });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amomax_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) {
+        return static_cast<std::int32_t>(value) > static_cast<std::int32_t>(src) ? value : src;
+    });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amominu_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) { return value < src ? value : src; });
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_amomaxu_w(const DecodedInstruction& instruction) {
+    amo_w(instruction, [](std::uint32_t value, std::uint32_t src) { return value > src ? value : src; });
+}
+
+// Same as the JIT: nothing else runs between a hart's LR and SC, so the reservation always holds and SC always succeeds
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_lr_w(const DecodedInstruction& instruction) {
+    std::uint32_t value = core->bus.read32(core->registers[instruction.rs1]);
+
+    core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(value));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv32i_sc_w(const DecodedInstruction& instruction) {
+    core->bus.write32(core->registers[instruction.rs1], core->registers[instruction.rs2]);
+
+    core->registers[instruction.rd] = 0;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+inline void Interpreter<xlen, is_embedded, extensions>::count_fusion(Op op) {
+    auto& count = fusion_counts[static_cast<std::size_t>(op) - FIRST_FUSED_OP];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Fused pairs; each one retires both instructions, so PC moves past the second
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_lui_addi(const DecodedInstruction& instruction) {
+    count_fusion(Op::LuiAddi);
+
+    core->registers[instruction.rd] = static_cast<reg_t>(instruction.imm);
+    core->pc += 4;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_auipc_jalr(const DecodedInstruction& instruction) {
+    count_fusion(Op::AuipcJalr);
+
+    reg_t base = static_cast<std::uint32_t>(instruction.imm);
+    reg_t link = core->pc + 8;
+
+    core->registers[instruction.rd] = base;
+    core->pc = ((base + instruction.fused_imm) & ~static_cast<reg_t>(1)) - 4;
+    core->registers[instruction.rs2] = link;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_auipc_lw(const DecodedInstruction& instruction) {
+    count_fusion(Op::AuipcLw);
+
+    std::uint8_t rd = instruction.rs2;
+    reg_t base = static_cast<std::uint32_t>(instruction.imm);
+
+    core->registers[instruction.rd] = base;
+    core->registers[rd] = static_cast<reg_t>(static_cast<std::int32_t>(core->bus.read32(base + instruction.fused_imm)));
+    core->pc += 4;
+}
+
+// The branch sits at PC + 4, so a taken branch lands on PC + offset after step()'s increment
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_sltu_bnez(const DecodedInstruction& instruction) {
+    count_fusion(Op::SltuBnez);
+
+    reg_t result = (core->registers[instruction.rs1] < core->registers[instruction.rs2]) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+    core->pc += result ? instruction.fused_imm : 4;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_sltu_beqz(const DecodedInstruction& instruction) {
+    count_fusion(Op::SltuBeqz);
+
+    reg_t result = (core->registers[instruction.rs1] < core->registers[instruction.rs2]) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+    core->pc += result ? 4 : instruction.fused_imm;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_sltiu_bnez(const DecodedInstruction& instruction) {
+    count_fusion(Op::SltiuBnez);
+
+    reg_t result = (core->registers[instruction.rs1] < static_cast<reg_t>(instruction.imm)) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+    core->pc += result ? instruction.fused_imm : 4;
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::fused_sltiu_beqz(const DecodedInstruction& instruction) {
+    count_fusion(Op::SltiuBeqz);
+
+    reg_t result = (core->registers[instruction.rs1] < static_cast<reg_t>(instruction.imm)) ? 1 : 0;
+
+    core->registers[instruction.rd] = result;
+    core->pc += result ? 4 : instruction.fused_imm;
+}
+
+// RV64I
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_ld(const DecodedInstruction& instruction) {
+	std::uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	std::uint64_t low = core->bus.read32(effective_address);
+	std::uint64_t high = core->bus.read32(effective_address + 4);
+
+	core->registers[instruction.rd] = static_cast<reg_t>((high << 32) | low);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_lwu(const DecodedInstruction& instruction) {
+	std::uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+
+	core->registers[instruction.rd] = core->bus.read32(effective_address);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_sd(const DecodedInstruction& instruction) {
+	std::uint32_t effective_address = core->registers[instruction.rs1] + instruction.imm;
+	std::uint64_t value = core->registers[instruction.rs2];
+
+	core->bus.write32(effective_address, static_cast<std::uint32_t>(value));
+	core->bus.write32(effective_address + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+// The *W forms operate on the low word and sign-extend the result
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_addiw(const DecodedInstruction& instruction) {
+	std::uint32_t result = static_cast<std::uint32_t>(core->registers[instruction.rs1]) + instruction.imm;
+
+	core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(result));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_slliw(const DecodedInstruction& instruction) {
+	std::uint32_t result = static_cast<std::uint32_t>(core->registers[instruction.rs1]) << (instruction.imm & 0x1F);
+
+	core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(result));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_srliw(const DecodedInstruction& instruction) {
+	std::uint32_t result = static_cast<std::uint32_t>(core->registers[instruction.rs1]) >> (instruction.imm & 0x1F);
+
+	core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(result));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_sraiw(const DecodedInstruction& instruction) {
+	std::int32_t result = static_cast<std::int32_t>(core->registers[instruction.rs1]) >> (instruction.imm & 0x1F);
+
+	core->registers[instruction.rd] = static_cast<reg_t>(result);
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_addw(const DecodedInstruction& instruction) {
+	std::uint32_t result = static_cast<std::uint32_t>(core->registers[instruction.rs1] + core->registers[instruction.rs2]);
+
+	core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(result));
+}
+
+template <std::uint8_t xlen, bool is_embedded, std::uint32_t extensions>
+void Interpreter<xlen, is_embedded, extensions>::rv64i_subw(const DecodedInstruction& instruction) {
+	std::uint32_t result = static_cast<std::uint32_t>(core->registers[instruction.rs1] - core->registers[instruction.rs2]);
+
+	core->registers[instruction.rd] = static_cast<reg_t>(static_cast<std::int32_t>(result));
+}
@@ -0,0 +1,278 @@
+#include <cpu/core/backends/jit_memory_manager.h>
+#include <log/log.hh>
+#include <llvm/Support/MathExtras.h>
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Transparent huge pages are this big on x86-64 and most aarch64 kernels
+static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+// Smallest piece the arena hands out, keeps the free lists from filling up with slivers
+static constexpr std::size_t ARENA_GRANULE = 16;
+
+JITArena::JITArena(std::size_t hot_code_size, std::size_t code_size, std::size_t data_size) {
+    std::array<std::size_t, static_cast<std::size_t>(Region::Count)> sizes = {
+        llvm::alignTo(hot_code_size, HUGE_PAGE_SIZE),
+        llvm::alignTo(code_size, HUGE_PAGE_SIZE),
+        llvm::alignTo(data_size, HUGE_PAGE_SIZE),
+        llvm::alignTo(data_size, HUGE_PAGE_SIZE)};
+    std::size_t total = 0;
+    for (std::size_t size : sizes) {
+        total += size;
+    }
+
+#ifdef __linux__
+    int fd = memfd_create("risky-jit", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, total) != 0) {
+        Logger::error("Failed to create the JIT arena: " + std::string(std::strerror(errno)));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    // Reserved one huge page over so the runtime view can start on a huge page boundary
+    void* reservation = mmap(nullptr, total + HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void* writable = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (reservation == MAP_FAILED || writable == MAP_FAILED) {
+        Logger::error("Failed to map the JIT arena: " + std::string(std::strerror(errno)));
+        if (reservation != MAP_FAILED) {
+            munmap(reservation, total + HUGE_PAGE_SIZE);
+        }
+        if (writable != MAP_FAILED) {
+            munmap(writable, total);
+        }
+        close(fd);
+        return;
+    }
+
+    memory = llvm::sys::MemoryBlock(reservation, total + HUGE_PAGE_SIZE);
+    runtime_base = reinterpret_cast<std::uint8_t*>(llvm::alignTo(reinterpret_cast<std::uintptr_t>(reservation), HUGE_PAGE_SIZE));
+    writable_base = static_cast<std::uint8_t*>(writable);
+    total_size = total;
+
+    static constexpr std::array<int, static_cast<std::size_t>(Region::Count)> protections = {
+        PROT_READ | PROT_EXEC, PROT_READ | PROT_EXEC, PROT_READ, PROT_READ | PROT_WRITE};
+
+    std::size_t offset = 0;
+    bool mapped = true;
+    for (std::size_t region = 0; region < spans.size(); region++) {
+        mapped = mapped && mmap(runtime_base + offset, sizes[region], protections[region], MAP_SHARED | MAP_FIXED, fd, offset) != MAP_FAILED;
+        spans[region].base = writable_base + offset;
+        spans[region].size = sizes[region];
+        offset += sizes[region];
+    }
+    close(fd);
+
+    if (!mapped) {
+        Logger::error("Failed to map the JIT arena's runtime view: " + std::string(std::strerror(errno)));
+        munmap(writable_base, total_size);
+        munmap(reservation, total + HUGE_PAGE_SIZE);
+        memory = {};
+        runtime_base = writable_base = nullptr;
+        total_size = 0;
+        spans = {};
+        return;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Only a hint, shared memory gets huge pages where shmem_enabled allows advise, small ones otherwise
+    if (madvise(runtime_base, total, MADV_HUGEPAGE) != 0) {
+        Logger::info("JIT arena runs without huge pages");
+    }
+#endif
+#else
+    (void)total;
+    Logger::info("JIT arena needs memfd, every JIT section gets pages of its own");
+#endif
+}
+
+JITArena::~JITArena() {
+#ifdef __linux__
+    if (writable_base) {
+        munmap(writable_base, total_size);
+        munmap(memory.base(), memory.allocatedSize());
+    }
+#endif
+}
+
+std::uint8_t* JITArena::allocate(Region region, std::size_t size, std::size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Span& span = spans[static_cast<std::size_t>(region)];
+    size = llvm::alignTo(std::max<std::size_t>(size, 1), ARENA_GRANULE);
+    alignment = std::max(alignment, ARENA_GRANULE);
+
+    // Lowest hole first, the top of the region only grows when nothing below fits
+    for (auto range = span.free_ranges.begin(); range != span.free_ranges.end(); ++range) {
+        auto [offset, length] = *range;
+        std::size_t start = llvm::alignTo(offset, alignment);
+        if (start + size > offset + length) {
+            continue;
+        }
+
+        span.free_ranges.erase(range);
+        if (start > offset) {
+            span.free_ranges[offset] = start - offset;
+        }
+        if (start + size < offset + length) {
+            span.free_ranges[start + size] = offset + length - start - size;
+        }
+        return span.base + start;
+    }
+
+    std::size_t start = llvm::alignTo(span.end, alignment);
+    if (start + size > span.size) {
+        if (!reported_full && span.size) {
+            Logger::warn("JIT arena region is full, some blocks are placed outside it");
+            reported_full = true;
+        }
+        return nullptr;
+    }
+
+    if (start > span.end) {
+        release(span, span.end, start - span.end);
+    }
+    span.end = start + size;
+    return span.base + start;
+}
+
+void JITArena::release(Region region, std::uint8_t* address, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Span& span = spans[static_cast<std::size_t>(region)];
+    release(span, address - span.base, llvm::alignTo(std::max<std::size_t>(size, 1), ARENA_GRANULE));
+}
+
+std::uint64_t JITArena::runtime_address(const std::uint8_t* address) const {
+    return reinterpret_cast<std::uintptr_t>(runtime_base + (address - writable_base));
+}
+
+void JITArena::release(Span& span, std::size_t offset, std::size_t size) {
+    // Merged with both neighbours, so a hole never sits right next to another
+    auto next = span.free_ranges.lower_bound(offset);
+    if (next != span.free_ranges.end() && offset + size == next->first) {
+        size += next->second;
+        next = span.free_ranges.erase(next);
+    }
+
+    if (next != span.free_ranges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            span.free_ranges.erase(previous);
+        }
+    }
+
+    // Giving back the top lets the region shrink instead of keeping a hole there
+    if (offset + size == span.end) {
+        span.end = offset;
+    } else {
+        span.free_ranges[offset] = size;
+    }
+}
+
+JITArenaMemoryManager::JITArenaMemoryManager(JITArena& arena, bool hot) : arena(arena), hot(hot) {}
+
+JITArenaMemoryManager::~JITArenaMemoryManager() {
+    for (const Allocation& allocation : allocations) {
+        arena.release(allocation.region, allocation.address, allocation.size);
+    }
+
+    for (OverflowBlock& overflow_block : overflow) {
+        llvm::sys::Memory::releaseMappedMemory(overflow_block.block);
+    }
+}
+
+std::uint8_t* JITArenaMemoryManager::allocateCodeSection(uintptr_t size, unsigned alignment, unsigned,
+                                                         llvm::StringRef) {
+    // Hot code spills over into the cold region before leaving the arena
+    if (hot) {
+        if (std::uint8_t* address = arena.allocate(JITArena::Region::HotCode, size, alignment)) {
+            allocations.push_back({JITArena::Region::HotCode, address, size});
+            return address;
+        }
+    }
+
+    return allocate(JITArena::Region::Code, size, alignment);
+}
+
+std::uint8_t* JITArenaMemoryManager::allocateDataSection(uintptr_t size, unsigned alignment, unsigned,
+                                                         llvm::StringRef, bool read_only) {
+    return allocate(read_only ? JITArena::Region::ReadOnlyData : JITArena::Region::Data, size, alignment);
+}
+
+void JITArenaMemoryManager::notifyObjectLoaded(llvm::RuntimeDyld& dyld, const llvm::object::ObjectFile&) {
+    // Relocations and symbol addresses are resolved against the runtime view from here on
+    for (const Allocation& allocation : allocations) {
+        dyld.mapSectionAddress(allocation.address, arena.runtime_address(allocation.address));
+    }
+}
+
+void JITArenaMemoryManager::registerEHFrames(std::uint8_t*, std::uint64_t load_address, std::size_t size) {
+    // The unwinder reads the frames where they were relocated for, in the runtime view
+    RTDyldMemoryManager::registerEHFrames(reinterpret_cast<std::uint8_t*>(load_address), load_address, size);
+}
+
+bool JITArenaMemoryManager::finalizeMemory(std::string* error) {
+    // The arena's views never change protection, only the instruction cache is left
+    for (const Allocation& allocation : allocations) {
+        if (allocation.region == JITArena::Region::HotCode || allocation.region == JITArena::Region::Code) {
+            llvm::sys::Memory::InvalidateInstructionCache(reinterpret_cast<void*>(arena.runtime_address(allocation.address)),
+                                                          allocation.size);
+        }
+    }
+
+    for (OverflowBlock& overflow_block : overflow) {
+        unsigned flags;
+        switch (overflow_block.region) {
+            case JITArena::Region::HotCode:
+            case JITArena::Region::Code:
+                flags = llvm::sys::Memory::MF_READ | llvm::sys::Memory::MF_EXEC;
+                break;
+            case JITArena::Region::ReadOnlyData:
+                flags = llvm::sys::Memory::MF_READ;
+                break;
+            default:
+                continue;
+        }
+
+        if (std::error_code result = llvm::sys::Memory::protectMappedMemory(overflow_block.block, flags)) {
+            if (error) {
+                *error = result.message();
+            }
+            return true;
+        }
+
+        if (flags & llvm::sys::Memory::MF_EXEC) {
+            llvm::sys::Memory::InvalidateInstructionCache(overflow_block.block.base(), overflow_block.block.allocatedSize());
+        }
+    }
+
+    return false;
+}
+
+std::uint8_t* JITArenaMemoryManager::allocate(JITArena::Region region, std::size_t size, std::size_t alignment) {
+    alignment = std::max<std::size_t>(alignment, 1);
+    if (std::uint8_t* address = arena.allocate(region, size, alignment)) {
+        allocations.push_back({region, address, size});
+        return address;
+    }
+
+    // Mapped next to the arena, like SectionMemoryManager maps next to its last block, and
+    // only writable until finalizeMemory()
+    std::error_code error;
+    llvm::sys::MemoryBlock block = llvm::sys::Memory::allocateMappedMemory(size + alignment, &arena.mapping(),
+        llvm::sys::Memory::MF_READ | llvm::sys::Memory::MF_WRITE, error);
+    if (error) {
+        Logger::error("Failed to map JIT section memory: " + error.message());
+        return nullptr;
+    }
+
+    overflow.push_back({region, block});
+    return reinterpret_cast<std::uint8_t*>(llvm::alignTo(reinterpret_cast<std::uintptr_t>(block.base()), alignment));
+}
@@ -0,0 +1,173 @@
+#include <cpu/core/backends/jit_object_cache.h>
+#include <log/log.hh>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#if LLVM_VERSION_MAJOR >= 17
+#include <llvm/TargetParser/Host.h>
+#else
+#include <llvm/Support/Host.h>
+#endif
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+static constexpr const char* MODULE_PREFIX = "jit_";
+
+JITObjectCache::JITObjectCache(std::filesystem::path directory, std::uint32_t version)
+    : directory(directory / ("v" + std::to_string(version))) {
+    std::string host = std::string(LLVM_VERSION_STRING) + "/" + llvm::sys::getProcessTriple() + "/" + llvm::sys::getHostCPUName().str();
+    host_suffix = llvm::utohexstr(llvm::xxHash64(host), true);
+
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+    if (error) {
+        Logger::warn("JIT object cache disabled, can't create " + this->directory.string() + ": " + error.message());
+        this->directory.clear();
+        return;
+    }
+
+    remove_other_versions(directory);
+
+    for (const auto& entry : std::filesystem::directory_iterator(this->directory, error)) {
+        if (entry.is_regular_file(error)) {
+            total_bytes += entry.file_size(error);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (total_bytes > MAX_BYTES) {
+        evict();
+    }
+}
+
+std::filesystem::path JITObjectCache::default_directory() {
+    if (const char* enabled = std::getenv("RISKY_JIT_CACHE"); enabled && (!std::strcmp(enabled, "0") || !std::strcmp(enabled, "off"))) {
+        return {};
+    }
+
+    if (const char* cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home) {
+        return std::filesystem::path(cache_home) / "risky" / "jit";
+    }
+
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return std::filesystem::path(home) / ".cache" / "risky" / "jit";
+    }
+
+    return {};
+}
+
+void JITObjectCache::remove_other_versions(const std::filesystem::path& parent) {
+    std::error_code error;
+
+    for (const auto& entry : std::filesystem::directory_iterator(parent, error)) {
+        std::string name = entry.path().filename().string();
+        bool version_directory = name.size() > 1 && name[0] == 'v' &&
+                                 name.find_first_not_of("0123456789", 1) == std::string::npos;
+
+        // Objects from before caches were versioned sit right in the parent
+        if ((version_directory && entry.path() != directory) || name.rfind(MODULE_PREFIX, 0) == 0) {
+            std::filesystem::remove_all(entry.path(), error);
+        }
+    }
+}
+
+void JITObjectCache::evict() {
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> objects;
+    std::error_code error;
+
+    // Another emulator may be filling the same directory, so start from what's really there
+    total_bytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file(error)) {
+            total_bytes += entry.file_size(error);
+            objects.emplace_back(entry.last_write_time(error), entry.path());
+        }
+    }
+
+    std::sort(objects.begin(), objects.end());
+
+    for (const auto& [time, path] : objects) {
+        if (total_bytes <= MAX_BYTES / 4 * 3) {
+            break;
+        }
+
+        std::uintmax_t size = std::filesystem::file_size(path, error);
+        if (!error && std::filesystem::remove(path, error)) {
+            total_bytes -= size;
+        }
+    }
+}
+
+std::string JITObjectCache::module_name(std::uint64_t key) {
+    return MODULE_PREFIX + llvm::utohexstr(key, true);
+}
+
+std::filesystem::path JITObjectCache::object_path(const llvm::Module& module) const {
+    const std::string& name = module.getModuleIdentifier();
+    if (directory.empty() || name.rfind(MODULE_PREFIX, 0) != 0) {
+        return {};
+    }
+
+    return directory / (name + "-" + host_suffix + ".o");
+}
+
+bool JITObjectCache::contains(const llvm::Module& module) const {
+    std::filesystem::path path = object_path(module);
+    std::error_code error;
+    return !path.empty() && std::filesystem::is_regular_file(path, error);
+}
+
+void JITObjectCache::notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) {
+    std::filesystem::path path = object_path(*module);
+    if (path.empty()) {
+        return;
+    }
+
+    // Readers only ever see a complete object, the rename is atomic
+    auto file = llvm::sys::fs::TempFile::create(path.string() + ".tmp-%%%%%%");
+    if (!file) {
+        Logger::warn("Failed to cache JIT object " + path.string() + ": " + llvm::toString(file.takeError()));
+        return;
+    }
+
+    {
+        llvm::raw_fd_ostream out(file->FD, false);
+        out << object.getBuffer();
+    }
+
+    if (auto err = file->keep(path.string())) {
+        Logger::warn("Failed to cache JIT object " + path.string() + ": " + llvm::toString(std::move(err)));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    total_bytes += object.getBufferSize();
+    if (total_bytes > MAX_BYTES) {
+        evict();
+    }
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JITObjectCache::getObject(const llvm::Module* module) {
+    std::filesystem::path path = object_path(*module);
+    if (path.empty()) {
+        return nullptr;
+    }
+
+    auto buffer = llvm::MemoryBuffer::getFile(path.string());
+    if (!buffer) {
+        return nullptr;
+    }
+
+    // Keeps objects that are still used at the young end of the eviction order
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    return std::move(*buffer);
+}
@@ -1,353 +1,1954 @@
 #include <cpu/core/rv32/backends/rv32i_jit.h>
 #include <cpu/core/rv32/rv32i.h>
+#include <cpu/core/backends/interpreter.h>
 #include <log/log.hh>
 #include <risky.h>
 #include <cpu/core/core.h>
+#include <llvm/Config/llvm-config.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
-#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ObjectTransformLayer.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
-#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Verifier.h>
-#include <llvm/Support/raw_ostream.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 
-RV32IJIT::RV32IJIT(RV32I* core) : core(core) {
+thread_local std::unordered_map<std::string, size_t> RV32IJIT::code_sizes;
+thread_local std::unique_ptr<llvm::IRBuilder<>> RV32IJIT::builder;
+thread_local RV32IJIT::BlockRuntime* RV32IJIT::current_runtime = nullptr;
+thread_local uint8_t RV32IJIT::current_tier = 0;
+thread_local std::optional<uint32_t> RV32IJIT::hot_successor;
+thread_local llvm::BasicBlock* RV32IJIT::hot_path = nullptr;
+thread_local llvm::StructType* RV32IJIT::state_type = nullptr;
+thread_local llvm::Value* RV32IJIT::state_arg = nullptr;
+thread_local llvm::Value* RV32IJIT::runtime_arg = nullptr;
+thread_local std::array<llvm::Value*, RV32IJIT::STATE_FIELD_COUNT> RV32IJIT::state_fields{};
+thread_local std::array<llvm::Value*, 32> RV32IJIT::register_values{};
+thread_local uint32_t RV32IJIT::dirty_registers = 0;
+thread_local bool RV32IJIT::registers_in_slots = false;
+thread_local llvm::BasicBlock* RV32IJIT::entry_block = nullptr;
+thread_local std::array<llvm::AllocaInst*, 32> RV32IJIT::register_slots{};
+thread_local std::vector<RV32IJIT::InsertMark> RV32IJIT::deferred_flushes;
+thread_local llvm::Value* RV32IJIT::jump_target = nullptr;
+thread_local bool RV32IJIT::jump_pops_return = false;
+thread_local std::optional<uint32_t> RV32IJIT::jump_pushes_return;
+
+RV32IJIT::RV32IJIT(RV32I* core, bool tiered)
+    : state{core->registers, &core->pc, core->csrs, &core->bus, 0,
+            core->bus.main_memory, core->bus.code_page_flags(), static_cast<uint32_t>(core->bus.main_memory_size), nullptr, nullptr},
+      core(core) {
+    block_directory.resize((state.memory_size + CODE_PAGE_SIZE - 1) >> CODE_PAGE_SHIFT, nullptr);
+    state.block_directory = block_directory.data();
+    state.return_stack = &return_stack;
+
+    if (tiered) {
+        set_tier_thresholds(TIERED_COMPILE_THRESHOLD, OPTIMIZE_THRESHOLD);
+        set_opt_level(TIERED_OPT_LEVEL);
+    }
+
     // Initialize LLVM components
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
     llvm::InitializeNativeTargetAsmParser();
 
-    // Create context and builder
-    context = std::make_unique<llvm::LLVMContext>();
-    builder = std::make_unique<llvm::IRBuilder<>>(*context);
+    // Runs everything not compiled yet, and everything at all if LLJIT can't be set up
+    fallback = create_interpreter(core);
+    core->bus.add_code_observer(this);
+
+    // Warm starts reuse the objects earlier runs emitted for the same guest code
+    if (auto directory = JITObjectCache::default_directory(); !directory.empty()) {
+        object_cache = std::make_unique<JITObjectCache>(directory, OBJECT_CACHE_VERSION);
+    }
 
-    // Create module
-    module = std::make_unique<llvm::Module>("rv32i_jit", *context);
-    
-    // Create execution engine with module ownership
-    std::string errStr;
-    llvm::Module* modulePtr = module.get(); // Keep raw pointer
-    
-    executionEngine = std::unique_ptr<llvm::ExecutionEngine>(
-        llvm::EngineBuilder(std::unique_ptr<llvm::Module>(modulePtr))
-            .setErrorStr(&errStr)
-            .setEngineKind(llvm::EngineKind::JIT)
-            .create());
-
-    if (!executionEngine) {
-        Logger::error("Failed to create ExecutionEngine: " + errStr);
+    code_arena = std::make_unique<JITArena>(HOT_CODE_ARENA_BYTES, CODE_ARENA_BYTES, DATA_ARENA_BYTES);
+
+    // No compile threads, ORC then links each block inside the worker's lookup() and it's fully
+    // registered with its dylib before it can be published, or freed again
+    auto created = llvm::orc::LLJITBuilder()
+        .setObjectLinkingLayerCreator([this](llvm::orc::ExecutionSession& session, auto&&...)
+                -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+            // Linking runs on the worker that compiled the block, current_tier is still the block's
+            return std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(session, [this](auto&&...) {
+                return std::make_unique<JITArenaMemoryManager>(*code_arena, current_tier >= 2);
+            });
+        })
+        .setCompileFunctionCreator([this](llvm::orc::JITTargetMachineBuilder machine)
+                -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+            return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(machine), object_cache.get());
+        })
+        .create();
+
+    if (!created) {
+        Logger::error("Failed to create LLJIT, falling back to the interpreter: " + llvm::toString(created.takeError()));
+        ready = true;
         return;
     }
 
+    jit = std::move(*created);
+
+    // Sees every object before it's linked, which is the only place the emitted code size is visible
+    jit->getObjTransformLayer().setTransform([this](std::unique_ptr<llvm::MemoryBuffer> object)
+            -> llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> {
+        record_code_sizes(*object);
+        return object;
+    });
+
     Logger::info("JIT initialization successful");
+    register_helpers();
     initialize_opcode_table();
+
+    // Leave a core to the emulation thread, warm-up on big images scales with the rest
+    start_compile_workers(std::max(std::thread::hardware_concurrency(), 2u) - 1);
     ready = true;
 }
 
 void RV32IJIT::initialize_opcode_table() {
+    // Anything missing here, SYSTEM funct3 0 and fence.i included, is left to the fallback interpreter
     opcode_table = {
-        {0x63, OpcodeHandlerEntry{{{0b001, &RV32IJIT::rv32i_bne}}, nullptr}},
-        {0x73, OpcodeHandlerEntry{{{0b010, &RV32IJIT::rv32i_csrrs}}, nullptr}}
+        {LUI, OpcodeHandlerEntry{{}, &RV32IJIT::rv32i_lui}},
+        {AUIPC, OpcodeHandlerEntry{{}, &RV32IJIT::rv32i_auipc}},
+        {JAL, OpcodeHandlerEntry{{}, &RV32IJIT::rv32i_jal}},
+        {JALR, OpcodeHandlerEntry{{{0b000, &RV32IJIT::rv32i_jalr}}, nullptr}},
+        {BRANCH, OpcodeHandlerEntry{{
+            {0b000, &RV32IJIT::rv32i_beq},
+            {0b001, &RV32IJIT::rv32i_bne},
+            {0b100, &RV32IJIT::rv32i_blt},
+            {0b101, &RV32IJIT::rv32i_bge},
+            {0b110, &RV32IJIT::rv32i_bltu},
+            {0b111, &RV32IJIT::rv32i_bgeu}
+        }, nullptr}},
+        {LOAD, OpcodeHandlerEntry{{
+            {0b000, &RV32IJIT::rv32i_lb},
+            {0b001, &RV32IJIT::rv32i_lh},
+            {0b010, &RV32IJIT::rv32i_lw},
+            {0b100, &RV32IJIT::rv32i_lbu},
+            {0b101, &RV32IJIT::rv32i_lhu}
+        }, nullptr}},
+        {STORE, OpcodeHandlerEntry{{
+            {0b000, &RV32IJIT::rv32i_sb},
+            {0b001, &RV32IJIT::rv32i_sh},
+            {0b010, &RV32IJIT::rv32i_sw}
+        }, nullptr}},
+        {OPIMM, OpcodeHandlerEntry{{}, &RV32IJIT::rv32i_op_imm}},
+        {OP, OpcodeHandlerEntry{{}, &RV32IJIT::rv32i_op}},
+        {MISCMEM, OpcodeHandlerEntry{{{0b000, &RV32IJIT::rv32i_fence}}, nullptr}},
+        {AMO, OpcodeHandlerEntry{{}, &RV32IJIT::rv32a_amo}},
+        {SYSTEM, OpcodeHandlerEntry{{
+            {0b001, &RV32IJIT::rv32i_csrrw},
+            {0b010, &RV32IJIT::rv32i_csrrs},
+            {0b011, &RV32IJIT::rv32i_csrrc},
+            {0b101, &RV32IJIT::rv32i_csrrwi},
+            {0b110, &RV32IJIT::rv32i_csrrsi},
+            {0b111, &RV32IJIT::rv32i_csrrci}
+        }, nullptr}}
     };
 }
 
 RV32IJIT::~RV32IJIT() {
-    if (builder) {
-        builder.reset();
-    }
+    core->bus.remove_code_observer(this);
+    stop_compile_workers();
 
-    if (executionEngine) {
-        if (module) {
-            executionEngine->removeModule(module.get());
-            module.reset();
-        }
-        executionEngine.reset();
-    }
+    // Blocks have to go before the session that owns their memory
+    finished_blocks.clear();
+    block_cache.clear();
+    block_states.clear();
+    retired_blocks.clear();
+    incoming_links.clear();
+    jit.reset();
+}
+
+void RV32IJIT::set_tier_thresholds(std::uint32_t compile_threshold, std::uint32_t optimize_threshold) {
+    this->compile_threshold = std::max<std::uint32_t>(compile_threshold, 1);
+    this->optimize_threshold = optimize_threshold;
+}
+
+void RV32IJIT::set_opt_level(std::uint8_t level) {
+    opt_level.store(std::min<std::uint8_t>(level, 3), std::memory_order_relaxed);
+}
 
-    if (context) {
-        context.reset();
+void RV32IJIT::set_compile_workers(unsigned count) {
+    // Without LLJIT there's nothing for them to compile
+    if (!jit) {
+        return;
     }
+
+    // Queued requests stay queued, the new workers pick them up
+    stop_compile_workers();
+    start_compile_workers(std::max(count, 1u));
 }
 
 void RV32IJIT::step() {
-    single_instruction_mode = true;
-    std::uint32_t opcode = core->fetch_opcode();
-    execute_opcode(opcode);
-    core->registers[0] = 0;
-    core->pc += 4;
-    single_instruction_mode = false;
+    std::lock_guard<std::mutex> lock(emulation_mutex);
+    // Stepping is meant to be exact, so never run a whole block here
+    fallback->step();
 }
 
-void RV32IJIT::run() {
-    std::uint32_t opcode = core->fetch_opcode();
-    execute_opcode(opcode);
-    core->registers[0] = 0;
-    core->pc += 4;
+ExitReason RV32IJIT::run(std::uint64_t max_instructions) {
+    std::lock_guard<std::mutex> lock(emulation_mutex);
+    ExitReason reason = jit ? run_blocks(max_instructions) : fallback->run(max_instructions);
+
+    if (snapshot_requested.exchange(false, std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex);
+        block_cache_snapshot = list_blocks();
+    }
+
+    return reason;
 }
 
-void RV32IJIT::execute_opcode(std::uint32_t opcode) {
-    uint32_t pc = core->pc;
-    
-    // Try to find existing block
-    Logger::info("Trying to search for block at PC: " + format("0x{:08X}", pc));
-    CompiledBlock* block = find_block(pc);
-    
-    if (!block) {
-        Logger::info("Block not found, compiling new block at PC: " + format("0x{:08X}", pc));
-        // Compile new block if not found
-        block = compile_block(pc, single_instruction_mode);
-        if (!block) {
-            Logger::error("Failed to compile block at PC: " + format("0x{:08X}", pc));
-            return;
+ExitReason RV32IJIT::run_blocks(std::uint64_t max_instructions) {
+    for (std::uint64_t executed = 0; executed < max_instructions; ) {
+        ExitReason reason = dispatch(executed, max_instructions - executed);
+        core->registers[0] = 0;
+
+        if (Risky::is_aborted()) {
+            return ExitReason::Error;
         }
-        
-        // Add to cache
-        if (block_cache.size() >= CACHE_SIZE) {
-            evict_oldest_block();
+
+        if (reason != ExitReason::BudgetExhausted) {
+            return reason;
         }
-        block_cache[pc] = *block;
     }
-    
-    // Execute block
-    block->last_used = ++execution_count;
-    auto exec_fn = (int (*)())block->code_ptr;
-    int result = exec_fn();
-    
-    Logger::info("Executed block at PC " + format("0x{:08X}", pc));
+
+    return ExitReason::BudgetExhausted;
 }
 
-CompiledBlock* RV32IJIT::compile_block(uint32_t start_pc, bool single_instruction) {
-    uint32_t current_pc = start_pc;
-    uint32_t end_pc = start_pc; // Initialize end_pc to start_pc
-    bool is_branch = false;
-    
-    // Create new module for this block
-    auto new_module = std::make_unique<llvm::Module>(
-        "block_" + std::to_string(start_pc), *context);
-    
-    if (!new_module) {
-        Logger::error("Failed to create LLVM module");
-        return nullptr;
+void RV32IJIT::execute_opcode(std::uint32_t opcode) {
+    std::lock_guard<std::mutex> lock(emulation_mutex);
+    // A lone opcode has no block to come from, the interpreter decodes and runs it like the other backends do
+    fallback->execute_opcode(opcode);
+}
+
+ExitReason RV32IJIT::dispatch(std::uint64_t& retired, std::uint64_t budget) {
+    if (has_finished.load(std::memory_order_acquire)) {
+        publish_finished_blocks();
     }
-        
-    // Create function and basic block
-    llvm::FunctionType *funcType = llvm::FunctionType::get(builder->getInt32Ty(), false);
-    llvm::Function *func = llvm::Function::Create(funcType, 
-                                                llvm::Function::ExternalLinkage,
-                                                "exec_" + std::to_string(start_pc),
-                                                new_module.get());
 
-    llvm::BasicBlock *entry = llvm::BasicBlock::Create(*context, "entry", func);
-    builder->SetInsertPoint(entry);
+    // No compiled code is on the stack here, so dropped blocks can finally be freed
+    if (!retired_blocks.empty()) {
+        free_retired_blocks();
+    }
 
-    while (true) {
-        uint32_t opcode = core->fetch_opcode(current_pc);
-        
-        // Generate IR for opcode
-        auto [branch, current_pc_, error] = generate_ir_for_opcode(opcode, current_pc);
+    uint32_t pc = core->pc;
+    BlockEntry* entry = block_entry(pc, false);
+    CompiledBlock* block = entry ? entry->block : find_block(pc);
+    BlockRuntime* runtime = block ? (entry ? entry->runtime : block_states[pc].runtime.get()) : nullptr;
 
-        is_branch = branch;
+    // Never wait on LLVM, interpret until the worker publishes native code. The last few instructions
+    // of a budget are interpreted as well once they're fewer than the block could run
+    if (!block || runtime->max_instructions > budget) {
+        if (!block) {
+            if (block_hotness.size() >= MAX_HOTNESS_ENTRIES) {
+                block_hotness.clear();
+            }
 
-        if (error) {
-            Logger::error("Error generating IR for opcode");
-            Risky::exit(1, Risky::Subsystem::Core);
-            return nullptr;
+            if (at_block_entry && ++block_hotness[pc] >= compile_threshold) {
+                request_compile(pc, 1, block_hotness[pc]);
+                block_hotness.erase(pc);
+            }
+        }
+
+        std::uint8_t opcode_rv32 = core->fetch_opcode(pc) & 0x7F;
+        ExitReason reason = fallback->run(1);
+        retired++;
+        at_block_entry = core->pc != pc + 4 || opcode_rv32 == BRANCH;
+        return reason;
+    }
+
+    // Stay in here going from block to block, only a PC without native code goes back to the interpreter
+    state.chain_budget = static_cast<std::int64_t>(budget);
+    BlockExit reason;
+    do {
+        // Chained runs never come back through here, the block counts itself
+        block->executions = runtime->executions;
+        if (optimize_threshold && block->tier == 1 && block->executions >= optimize_threshold) {
+            request_compile(pc, 2, block->executions);
         }
 
-        // Check if opcode is a branch or jump
-        if (is_branch || single_instruction) {
-            end_pc = current_pc_;
+        // Execute block, it keeps going into linked successors and hands back where and why it stopped
+        block->last_used = ++execution_count;
+        auto exec_fn = (std::uint64_t (*)(JITState*, BlockRuntime*))block->code_ptr;
+        std::uint64_t exit = exec_fn(&state, runtime);
+        pc = static_cast<uint32_t>(exit);
+        reason = static_cast<BlockExit>(exit >> 32);
+
+        if (reason == BlockExit::BudgetExhausted || Risky::is_aborted()) {
             break;
         }
 
-        current_pc = current_pc_;
+        // The successor it couldn't link to may have been waiting to be published
+        if (has_finished.load(std::memory_order_acquire)) {
+            publish_finished_blocks();
+        }
+
+        entry = block_entry(pc, false);
+        block = entry ? entry->block : find_block(pc);
+        runtime = block ? (entry ? entry->runtime : block_states[pc].runtime.get()) : nullptr;
+    } while (block && runtime->max_instructions <= state.chain_budget);
+
+    retired += budget - state.chain_budget;
+    at_block_entry = true;
+
+    return ExitReason::BudgetExhausted;
+}
+
+std::vector<CompiledBlock> RV32IJIT::get_compiled_blocks() const {
+    // Without a run() in progress nothing can change the cache while it's copied
+    std::unique_lock<std::mutex> lock(emulation_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        return list_blocks();
     }
 
-    builder->CreateRetVoid();
+    // Never wait for the emulation thread, take the copy it made at the end of an earlier run()
+    snapshot_requested.store(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex);
+    return block_cache_snapshot;
+}
 
-    std::string str;
-    llvm::raw_string_ostream os(str);
-    new_module->print(os, nullptr);
-    os.flush();
+std::vector<CompiledBlock> RV32IJIT::list_blocks() const {
+    std::vector<CompiledBlock> blocks;
+    blocks.reserve(block_cache.size());
+    for (const auto& [pc, block] : block_cache) {
+        blocks.push_back(block);
+    }
 
-    // Add module to execution engine
-    if (!executionEngine) {
-        Logger::error("Execution engine is not initialized");
-        return nullptr;
+    std::sort(blocks.begin(), blocks.end(), [](const CompiledBlock& a, const CompiledBlock& b) { return a.start_pc < b.start_pc; });
+    return blocks;
+}
+
+void RV32IJIT::request_compile(uint32_t pc, uint8_t tier, uint64_t heat) {
+    auto& requested = tier == 1 ? requested_blocks : optimize_requested;
+    if (!jit || !requested.insert(pc).second) {
+        return;
     }
 
-    executionEngine->addModule(std::move(new_module));
-    executionEngine->finalizeObject();
-    
-    auto exec_fn = (void (*)())executionEngine->getPointerToFunction(func);
-    if (!exec_fn) {
-        Logger::error("Failed to JIT compile function");
-        return nullptr;
+    // Outside RAM, or misaligned, there's no page to hand the worker, the block stays with the fallback
+    const std::uint8_t* host_page = core->bus.host_page(pc);
+    if (!host_page || (pc & 3)) {
+        return;
     }
 
-    // Create and return compiled block
-    auto block = new CompiledBlock();
-    block->start_pc = start_pc;
-    block->end_pc = end_pc;
-    block->code_ptr = (void*)exec_fn;
-    block->last_used = execution_count;
-    block->contains_branch = is_branch;
-    block->llvm_ir = str;
+    // From here on a store to the page makes whatever the worker translates stale
+    uint32_t page = pc & ~(CODE_PAGE_SIZE - 1);
+    core->bus.mark_code_page(pc);
+    page_blocks[page].insert(pc);
 
-    return block;
+    CompileRequest request{pc, tier, page_writes[page], {pc}, std::vector<uint32_t>(CODE_PAGE_SIZE / 4)};
+    std::memcpy(request.code.data(), host_page, CODE_PAGE_SIZE);
+    request.heat = heat;
+    request.sequence = request_count++;
+    if (tier >= 2) {
+        select_trace(request);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        compile_queue.push_back(std::move(request));
+        std::push_heap(compile_queue.begin(), compile_queue.end(), compiles_after);
+    }
+    compile_cv.notify_one();
 }
 
-CompiledBlock* RV32IJIT::find_block(uint32_t pc) {
-    auto it = block_cache.find(pc);
-    if (it != block_cache.end()) {
-        return &it->second;
+bool RV32IJIT::compiles_after(const CompileRequest& a, const CompileRequest& b) {
+    if (a.tier != b.tier) {
+        return a.tier > b.tier;
     }
-    return nullptr;
+
+    if (a.heat != b.heat) {
+        return a.heat < b.heat;
+    }
+
+    return a.sequence > b.sequence;
 }
 
-void RV32IJIT::evict_oldest_block() {
-    if (lru_queue.empty()) return;
-    uint32_t oldest_pc = lru_queue.front();
-    lru_queue.erase(lru_queue.begin());
-    block_cache.erase(oldest_pc);
+void RV32IJIT::select_trace(CompileRequest& request) {
+    // Runs on the emulation thread, the only one the exit counters are written from
+    uint32_t page = request.pc & ~(CODE_PAGE_SIZE - 1);
+    uint32_t current = request.pc;
+
+    while (request.trace.size() < MAX_TRACE_BLOCKS) {
+        auto state = block_states.find(current);
+        if (state == block_states.end()) {
+            return;
+        }
+
+        // Optimized blocks don't count their exits, so a trace ends at the first one it runs into
+        const BlockRuntime& runtime = *state->second.runtime;
+        uint64_t total = 0;
+        uint8_t hottest = 0;
+        for (uint8_t slot = 0; slot < runtime.link_count; slot++) {
+            total += runtime.exit_counts[slot];
+            if (runtime.exit_counts[slot] > runtime.exit_counts[hottest]) {
+                hottest = slot;
+            }
+        }
+
+        if (total == 0 || runtime.exit_counts[hottest] * 100 < total * TRACE_BIAS_PERCENT) {
+            return;
+        }
+
+        uint32_t next = runtime.targets[hottest];
+        if (next == request.pc) {
+            request.trace_loops = true;
+            return;
+        }
+
+        // Staying on the head's page lets code_written() drop the whole trace along with its head
+        if ((next & ~(CODE_PAGE_SIZE - 1)) != page || !block_states.count(next) ||
+            std::find(request.trace.begin(), request.trace.end(), next) != request.trace.end()) {
+            return;
+        }
+
+        request.trace.push_back(next);
+        current = next;
+    }
 }
 
-void RV32IJIT::no_ext(std::string extension) {
-	std::ostringstream logMessage;
-	logMessage << "FATAL ERROR: Called a " << extension.c_str() << " extension opcode but it's unavailable for this core!";
+void RV32IJIT::publish_finished_blocks() {
+    std::vector<FinishedBlock> finished;
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        finished.swap(finished_blocks);
+        has_finished.store(false, std::memory_order_relaxed);
+    }
 
-	Logger::error(logMessage.str());
+    for (auto& result : finished) {
+        uint32_t pc = result.block.start_pc;
 
-	Risky::exit(1, Risky::Subsystem::Core);
+        // The page was written while the worker read it, code_written() already let the block be requested again
+        if (page_writes[pc & ~(CODE_PAGE_SIZE - 1)] != result.page_writes) {
+            if (result.state.dylib) {
+                retired_blocks.push_back(std::move(result.state));
+            }
+            continue;
+        }
+
+        // Uncompilable blocks stay requested so they're never queued again, until their page changes
+        if (!result.state.dylib) {
+            continue;
+        }
+
+        result.block.last_used = execution_count;
+
+        // An optimized recompile takes over the clock position of the block it replaces
+        auto existing = block_states.find(pc);
+        if (existing != block_states.end()) {
+            result.state.clock_position = existing->second.clock_position;
+            release_block(pc);
+        } else {
+            while (!clock_ring.empty() && (block_cache.size() >= CACHE_SIZE || code_bytes + result.block.code_size > CODE_CACHE_BYTES)) {
+                evict_block();
+            }
+
+            // Inserted just behind the hand, so it gets a full lap before it can be picked
+            result.state.clock_position = clock_ring.insert(clock_hand, pc);
+        }
+
+        code_bytes += result.block.code_size;
+        CompiledBlock& block = block_cache[pc] = std::move(result.block);
+        BlockState& block_state = block_states[pc] = std::move(result.state);
+
+        if (BlockEntry* entry = block_entry(pc, true)) {
+            *entry = {block.code_ptr, block_state.runtime.get(), &block};
+        }
+
+        link_block(pc);
+    }
 }
 
-void RV32IJIT::unknown_rv16_opcode(std::uint16_t opcode) {
-    std::ostringstream logMessage;
-    logMessage << "Unimplemented LLVM IR RV16 Opcode: 0x" << format("{:04X}", opcode);
+void RV32IJIT::link_block(uint32_t pc) {
+    BlockRuntime* runtime = block_states[pc].runtime.get();
 
-    Logger::error(logMessage.str());
+    for (uint8_t slot = 0; slot < runtime->link_count; slot++) {
+        uint32_t target = runtime->targets[slot];
+        incoming_links[target].push_back({runtime, slot});
 
-    Risky::exit(1, Risky::Subsystem::Core);
+        auto successor = block_cache.find(target);
+        if (successor != block_cache.end()) {
+            runtime->next_runtime[slot] = block_states[target].runtime.get();
+            runtime->next[slot] = successor->second.code_ptr;
+        }
+    }
+
+    void* code = block_cache[pc].code_ptr;
+    for (auto& [predecessor, slot] : incoming_links[pc]) {
+        predecessor->next_runtime[slot] = runtime;
+        predecessor->next[slot] = code;
+    }
 }
 
-void RV32IJIT::unknown_rv32_opcode(std::uint32_t opcode) {
-    std::ostringstream logMessage;
-    logMessage << "Unimplemented LLVM IR RV32 Opcode: 0x" << format("{:08X}", opcode);
+void RV32IJIT::unlink_block(uint32_t pc) {
+    auto state = block_states.find(pc);
+    if (state == block_states.end()) {
+        return;
+    }
 
-    Logger::error(logMessage.str());
+    BlockRuntime* runtime = state->second.runtime.get();
 
-    Risky::exit(1, Risky::Subsystem::Core);
+    // Nothing may jump into code that's about to be freed, the slots stay registered for a recompile
+    auto incoming = incoming_links.find(pc);
+    if (incoming != incoming_links.end()) {
+        for (auto& [predecessor, slot] : incoming->second) {
+            predecessor->next[slot] = nullptr;
+        }
+    }
+
+    // A return predicted into this runtime may still read its slots after it's gone from incoming_links
+    for (uint8_t slot = 0; slot < runtime->link_count; slot++) {
+        runtime->next[slot] = nullptr;
+
+        auto links = incoming_links.find(runtime->targets[slot]);
+        if (links == incoming_links.end()) {
+            continue;
+        }
+
+        std::erase_if(links->second, [runtime](const auto& link) {
+            return link.first == runtime;
+        });
+
+        // Nobody compiled is waiting on that PC any more
+        if (links->second.empty() && !block_states.count(links->first)) {
+            incoming_links.erase(links);
+        }
+    }
 }
 
-void RV32IJIT::unknown_branch_opcode(std::uint8_t funct3) {
-	std::ostringstream logMessage;
-	logMessage << "Unimplemented LLVM IR BRANCH opcode: 0b" << format("{:08b}", funct3);
+void RV32IJIT::release_block(uint32_t pc) {
+    unlink_block(pc);
 
-	Logger::error(logMessage.str());
+    auto state = block_states.find(pc);
+    if (state == block_states.end()) {
+        return;
+    }
 
-	Risky::exit(1, Risky::Subsystem::Core);
+    if (BlockEntry* entry = block_entry(pc, false)) {
+        *entry = {};
+    }
+
+    // A store from inside the block itself can get it dropped, so its code has to outlive this call
+    retired_blocks.push_back(std::move(state->second));
+    block_states.erase(state);
+
+    auto block = block_cache.find(pc);
+    if (block != block_cache.end()) {
+        code_bytes -= block->second.code_size;
+    }
 }
 
-void RV32IJIT::unknown_zicsr_opcode(std::uint8_t funct3) {
-	std::ostringstream logMessage;
-	logMessage << "Unimplemented LLVM IR Zicsr opcode: 0b" << format("{:08b}", funct3);
+void RV32IJIT::discard_block(uint32_t pc) {
+    auto state = block_states.find(pc);
+    if (state != block_states.end()) {
+        auto position = state->second.clock_position;
+        if (clock_hand == position) {
+            clock_hand = clock_ring.erase(position);
+        } else {
+            clock_ring.erase(position);
+        }
 
-	Logger::error(logMessage.str());
+        release_block(pc);
+        block_cache.erase(pc);
+    }
 
-	Risky::exit(1, Risky::Subsystem::Core);
+    requested_blocks.erase(pc);
+    optimize_requested.erase(pc);
+
+    auto page = page_blocks.find(pc & ~(CODE_PAGE_SIZE - 1));
+    if (page != page_blocks.end()) {
+        page->second.erase(pc);
+        if (page->second.empty()) {
+            page_blocks.erase(page);
+        }
+    }
 }
 
-std::tuple<bool, uint32_t, bool> RV32IJIT::generate_ir_for_opcode(uint32_t opcode, uint32_t current_pc) {
-    bool is_branch = false;
-    bool error = false;
+void RV32IJIT::free_retired_blocks() {
+    // Removing the dylib hands the block's sections back to the memory manager
+    for (auto& state : retired_blocks) {
+        if (auto err = jit->getExecutionSession().removeJITDylib(*state.dylib)) {
+            Logger::error("Failed to free JIT block: " + llvm::toString(std::move(err)));
+        }
+    }
 
-    std::uint8_t opcode_rv32 = opcode & 0x7F;
-    std::uint8_t funct3 = (opcode >> 12) & 0x7;
+    retired_blocks.clear();
+    return_stack = {};
+}
 
-    auto opcode_it = opcode_table.find(opcode_rv32);
-    if (opcode_it != opcode_table.end()) {
-        if (opcode_it->second.single_handler) {
-            (this->*(opcode_it->second.single_handler))(opcode, current_pc, core);
-        } else {
-            auto funct3_it = opcode_it->second.funct3_map.find(funct3);
-            if (funct3_it != opcode_it->second.funct3_map.end()) {
-                (this->*(funct3_it->second))(opcode, current_pc, core);
+void RV32IJIT::code_written(std::uint32_t address) {
+    // Stores and fence.i both end up here through the bus, the page stays unmarked until something is requested from it again
+    uint32_t page = address & ~(CODE_PAGE_SIZE - 1);
+    page_writes[page]++;
+
+    auto blocks = page_blocks.find(page);
+    if (blocks == page_blocks.end()) {
+        return;
+    }
+
+    std::unordered_set<uint32_t> stale = std::move(blocks->second);
+    page_blocks.erase(blocks);
+
+    for (uint32_t pc : stale) {
+        discard_block(pc);
+    }
+}
+
+void RV32IJIT::compile_worker_loop() {
+    while (true) {
+        CompileRequest request;
+        {
+            std::unique_lock<std::mutex> lock(compile_mutex);
+            compile_cv.wait(lock, [this] { return stop_worker || !compile_queue.empty(); });
+
+            if (stop_worker) {
+                return;
             }
+
+            std::pop_heap(compile_queue.begin(), compile_queue.end(), compiles_after);
+            request = std::move(compile_queue.back());
+            compile_queue.pop_back();
+        }
+
+        FinishedBlock result = compile_block(request);
+        result.page_writes = request.page_writes;
+
+        {
+            std::lock_guard<std::mutex> lock(compile_mutex);
+            finished_blocks.push_back(std::move(result));
         }
+        has_finished.store(true, std::memory_order_release);
     }
-    else {
-        error = true;
+}
+
+void RV32IJIT::start_compile_workers(unsigned count) {
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        stop_worker = false;
     }
 
-    return {is_branch, current_pc, error};
+    for (unsigned worker = 0; worker < count; worker++) {
+        compile_workers.emplace_back(&RV32IJIT::compile_worker_loop, this);
+    }
 }
 
-void RV32IJIT::rv32i_csrrs(std::uint32_t opcode, uint32_t& current_pc, RV32I* core) {
-    uint8_t rd = (opcode >> 7) & 0x1F;
-    uint8_t rs1 = (opcode >> 15) & 0x1F;
-    uint8_t csr = (opcode >> 20) & 0xFFF;
+void RV32IJIT::stop_compile_workers() {
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        stop_worker = true;
+    }
+    compile_cv.notify_all();
 
-    // Get the base pointer for the registers array
-    llvm::Value *registers_base_ptr = builder->CreateIntToPtr(
-        builder->getInt64(reinterpret_cast<std::uintptr_t>(core->registers)),
-        llvm::PointerType::getUnqual(builder->getInt32Ty()));
+    for (auto& worker : compile_workers) {
+        worker.join();
+    }
+    compile_workers.clear();
+}
 
-    // Load the values from the source registers
-    llvm::Value *rs1_ptr = builder->CreateGEP(builder->getInt32Ty(), registers_base_ptr, builder->getInt32(rs1));
-    llvm::Value *rs1_val = builder->CreateLoad(builder->getInt32Ty(), rs1_ptr);
+RV32IJIT::FinishedBlock RV32IJIT::compile_block(const CompileRequest& request) {
+    auto compile_start = std::chrono::steady_clock::now();
+    uint32_t start_pc = request.pc;
+    uint8_t tier = request.tier;
+    FinishedBlock result;
+    result.state.runtime = std::make_unique<BlockRuntime>();
+    current_runtime = result.state.runtime.get();
+    current_tier = tier;
+    uint32_t end_pc = start_pc; // Initialize end_pc to start_pc
+    bool is_branch = false;
+    bool contains_branch = false;
 
-    // Load the value from the CSR
-    llvm::Value *csr_ptr = builder->CreateGEP(builder->getInt32Ty(), registers_base_ptr, builder->getInt32(csr));
-    llvm::Value *csr_val = builder->CreateLoad(builder->getInt32Ty(), csr_ptr);
+    result.block.start_pc = start_pc;
+    result.block.end_pc = start_pc;
 
-    // Perform the operation
-    llvm::Value *result = builder->CreateOr(rs1_val, csr_val);
+    // Every tier gets its own symbol, the old one stays live until the new one is published
+    std::string name = "exec_" + std::to_string(start_pc) + "_t" + std::to_string(tier);
 
-    // Store the result in the destination register
-    llvm::Value *rd_ptr = builder->CreateGEP(builder->getInt32Ty(), registers_base_ptr, builder->getInt32(rd));
-    builder->CreateStore(result, rd_ptr);
+    // Every module gets its own context so ORC can compile them on separate threads
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto new_module = std::make_unique<llvm::Module>(
+        "block_" + std::to_string(start_pc), *context);
+    builder = std::make_unique<llvm::IRBuilder<>>(*context);
 
-    current_pc += 4;
-}
+    llvm::Type *i32_ptr = llvm::PointerType::getUnqual(builder->getInt32Ty());
+    llvm::Type *i8_ptr = llvm::PointerType::getUnqual(builder->getInt8Ty());
+    state_type = llvm::StructType::create(*context,
+        {i32_ptr, i32_ptr, i32_ptr, i8_ptr, builder->getInt64Ty(), i8_ptr, i8_ptr, builder->getInt32Ty(),
+         llvm::PointerType::getUnqual(i8_ptr), i8_ptr}, "JITState");
 
-void RV32IJIT::rv32i_bne(std::uint32_t opcode, uint32_t& current_pc, RV32I* core) {
-    uint8_t rs1 = (opcode >> 15) & 0x1F;
-    uint8_t rs2 = (opcode >> 20) & 0x1F;
-    int32_t imm = ((opcode >> 7) & 0x1E) | ((opcode >> 20) & 0x7E0) | ((opcode << 4) & 0x800) | ((opcode >> 19) & 0x1000);
-    imm = (imm << 19) >> 19; // Sign-extend the immediate
+    // Create function and basic block, nothing else writes the state while a block runs
+    llvm::FunctionType *funcType = llvm::FunctionType::get(builder->getInt64Ty(),
+        {llvm::PointerType::getUnqual(state_type), i8_ptr}, false);
+    llvm::Function *func = llvm::Function::Create(funcType, 
+                                                llvm::Function::ExternalLinkage,
+                                                name,
+                                                new_module.get());
+    func->addParamAttr(0, llvm::Attribute::NoAlias);
+    state_arg = func->getArg(0);
+    state_arg->setName("state");
+    // Not noalias, a block that loops onto itself passes its own runtime along
+    runtime_arg = func->getArg(1);
+    runtime_arg->setName("runtime");
+
+    llvm::BasicBlock *entry = llvm::BasicBlock::Create(*context, "entry", func);
+    entry_block = entry;
+    builder->SetInsertPoint(entry);
 
-    // Get the base pointer for the registers array
-    llvm::Value *registers_base_ptr = builder->CreateIntToPtr(
-        builder->getInt64(reinterpret_cast<std::uintptr_t>(core->registers)),
-        llvm::PointerType::getUnqual(builder->getInt32Ty()));
+    for (unsigned field = STATE_REGISTERS; field < STATE_FIELD_COUNT; field++) {
+        if (field == STATE_CHAIN_BUDGET) {
+            continue;
+        }
 
-    // Load the values from the source registers
-    llvm::Value *rs1_ptr = builder->CreateGEP(builder->getInt32Ty(), registers_base_ptr, builder->getInt32(rs1));
-    llvm::Value *rs1_val = builder->CreateLoad(builder->getInt32Ty(), rs1_ptr);
+        llvm::Type *type = state_type->getElementType(field);
+        state_fields[field] = builder->CreateLoad(type, builder->CreateStructGEP(state_type, state_arg, field));
+    }
 
-    llvm::Value *rs2_ptr = builder->CreateGEP(builder->getInt32Ty(), registers_base_ptr, builder->getInt32(rs2));
-    llvm::Value *rs2_val = builder->CreateLoad(builder->getInt32Ty(), rs2_ptr);
+    register_values.fill(nullptr);
+    dirty_registers = 0;
+    registers_in_slots = request.trace_loops;
+    register_slots.fill(nullptr);
+    deferred_flushes.clear();
 
-    // Compare the values
-    llvm::Value *cond = builder->CreateICmpNE(rs1_val, rs2_val);
+    std::uint8_t level = opt_level.load(std::memory_order_relaxed);
+    if (tier >= 2) {
+        level = std::max(level, OPTIMIZED_TIER_OPT_LEVEL);
+    }
 
-    // Create basic blocks for the branch
-    llvm::BasicBlock *branch_block = llvm::BasicBlock::Create(*context, "branch", builder->GetInsertBlock()->getParent());
-    llvm::BasicBlock *continue_block = llvm::BasicBlock::Create(*context, "continue", builder->GetInsertBlock()->getParent());
+    // Everything that decides what this block compiles to, followed by its opcodes
+    std::vector<uint32_t> cache_key = {
+        OBJECT_CACHE_VERSION, start_pc, tier, level,
+        (uint32_t(core->has_m) << 0) | (uint32_t(core->has_a) << 1) | (uint32_t(core->has_zicsr) << 2),
+        uint32_t(request.trace.size()) | (uint32_t(request.trace_loops) << 31)
+    };
+    cache_key.insert(cache_key.end(), request.trace.begin(), request.trace.end());
 
-    // Conditionally branch
-    builder->CreateCondBr(cond, branch_block, continue_block);
+    // A trace that loops gets a header of its own, entry only runs once per call
+    llvm::BasicBlock *loop = nullptr;
+    if (request.trace_loops) {
+        loop = llvm::BasicBlock::Create(*context, "loop", func);
+        builder->CreateBr(loop);
+        builder->SetInsertPoint(loop);
+    }
 
-    // Branch block
-    builder->SetInsertPoint(branch_block);
-    builder->CreateStore(builder->getInt32(current_pc + imm), builder->CreateGEP(builder->getInt32Ty(), registers_base_ptr, builder->getInt32(32))); // Update PC
-    builder->CreateBr(continue_block);
+    std::uint32_t instructions = 0;
+    std::uint32_t segments = 0;
 
-    // Continue block
-    builder->SetInsertPoint(continue_block);
-    current_pc += 4;
+    // Tier 1 translates the block at start_pc, tier 2 every block of the trace, each one continuing where the last one's hot exit went
+    for (std::size_t segment = 0; segment < request.trace.size(); segment++) {
+        uint32_t current_pc = request.trace[segment];
+        bool last = segment + 1 == request.trace.size();
+        if (!last) {
+            hot_successor = request.trace[segment + 1];
+        } else if (request.trace_loops) {
+            hot_successor = start_pc;
+        } else {
+            hot_successor.reset();
+        }
+        hot_path = nullptr;
+
+        InsertMark segment_start = mark_position();
+        std::uint32_t segment_instructions = 0;
+
+        while (true) {
+            uint32_t opcode = request.code[(current_pc & (CODE_PAGE_SIZE - 1)) >> 2];
+
+            // Generate IR for opcode
+            auto [branch, current_pc_, error] = generate_ir_for_opcode(opcode, current_pc);
+
+            // The block stops in front of anything we can't translate, the fallback interpreter runs it
+            if (error) {
+                break;
+            }
+
+            segment_instructions++;
+            cache_key.push_back(opcode);
+            current_pc = current_pc_;
+            is_branch = branch;
+
+            // Blocks never leave their page, so fetching the next opcode can't run off the copy
+            if (is_branch || segment_instructions >= MAX_BLOCK_INSTRUCTIONS || (current_pc & (CODE_PAGE_SIZE - 1)) == 0) {
+                break;
+            }
+        }
+
+        if (segment_instructions == 0) {
+            if (segment == 0) {
+                builder.reset();
+                return result;
+            }
+
+            // The guest code changed since it was profiled, leave where the last block went
+            hot_successor.reset();
+            emit_exit(current_pc);
+            break;
+        }
+
+        segments++;
+        instructions += segment_instructions;
+        contains_branch |= is_branch;
+        end_pc = std::max(end_pc, current_pc);
+
+        // Branches and JAL already left through emit_exit(), JALR only worked out its target
+        if (!builder->GetInsertBlock()->getTerminator()) {
+            if (is_branch) {
+                emit_indirect_exit(jump_target);
+            } else {
+                emit_exit(current_pc);
+            }
+        }
+
+        // Now that the segment's length is known, charge it to the chain budget where it starts
+        insert_at(segment_start);
+        llvm::Value *budget_ptr = chain_budget_pointer();
+        builder->CreateStore(builder->CreateSub(builder->CreateLoad(builder->getInt64Ty(), budget_ptr), builder->getInt64(segment_instructions)), budget_ptr);
+
+        // None of the segment's exits went where the profile said
+        if (!hot_path) {
+            break;
+        }
+
+        builder->SetInsertPoint(hot_path);
+
+        // Go around again while the budget covers a whole lap, otherwise leave for the head like any other exit
+        if (last) {
+            llvm::Value *budget = builder->CreateLoad(builder->getInt64Ty(), chain_budget_pointer());
+            llvm::BasicBlock *leave = llvm::BasicBlock::Create(*context, "loop_exit", func);
+            builder->CreateCondBr(builder->CreateICmpSGE(budget, builder->getInt64(instructions)), loop, leave);
+
+            builder->SetInsertPoint(leave);
+            hot_successor.reset();
+            emit_exit(start_pc);
+        }
+    }
+
+    // Every register the loop writes has to be stored on each way out, only now is that set complete
+    for (const InsertMark& mark : deferred_flushes) {
+        insert_at(mark);
+        store_dirty_registers();
+    }
+
+    current_runtime->max_instructions = instructions;
+
+    // Count the run up front, once per call however many times a loop goes around
+    builder->SetInsertPoint(entry, entry->getFirstInsertionPt());
+    llvm::Value *executions_ptr = runtime_field(offsetof(BlockRuntime, executions), builder->getInt64Ty());
+    builder->CreateStore(builder->CreateAdd(builder->CreateLoad(builder->getInt64Ty(), executions_ptr), builder->getInt64(1)), executions_ptr);
+
+    builder.reset();
+
+    if (llvm::verifyFunction(*func, &llvm::errs())) {
+        Logger::error("Generated invalid IR for block at PC: " + format("0x{:08X}", start_pc));
+        return result;
+    }
+
+    new_module->setModuleIdentifier(JITObjectCache::module_name(llvm::xxHash64(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t*>(cache_key.data()), cache_key.size() * sizeof(uint32_t)))));
+
+    // A cached object is already optimized, the IR only has to exist for ORC to ask the cache for it
+    bool from_cache = object_cache && object_cache->contains(*new_module);
+    if (level > 0 && !from_cache) {
+        optimize_module(*new_module, level);
+    }
+
+    std::string str;
+    llvm::raw_string_ostream os(str);
+    new_module->print(os, nullptr);
+    os.flush();
+
+    // Hand the module to ORC in its own dylib so eviction can free its code, helpers resolve through the main one
+    auto dylib = jit->createJITDylib("block_" + std::to_string(dylib_count.fetch_add(1, std::memory_order_relaxed)));
+    if (!dylib) {
+        Logger::error("Failed to create JITDylib: " + llvm::toString(dylib.takeError()));
+        return result;
+    }
+    dylib->addToLinkOrder(jit->getMainJITDylib());
+
+    if (auto err = jit->addIRModule(*dylib, llvm::orc::ThreadSafeModule(std::move(new_module), std::move(context)))) {
+        Logger::error("Failed to add block to LLJIT: " + llvm::toString(std::move(err)));
+        llvm::consumeError(jit->getExecutionSession().removeJITDylib(*dylib));
+        return result;
+    }
+
+    // Looking the symbol up is what makes LLJIT emit machine code, do it here and not on the emulation thread
+    auto symbol = jit->lookup(*dylib, name);
+    if (!symbol) {
+        Logger::error("Failed to JIT compile block at PC " + format("0x{:08X}", start_pc) + ": " + llvm::toString(symbol.takeError()));
+        llvm::consumeError(jit->getExecutionSession().removeJITDylib(*dylib));
+        return result;
+    }
+
+    auto size = code_sizes.find(name);
+    result.block.code_size = size != code_sizes.end() ? size->second : 0;
+    if (size != code_sizes.end()) {
+        code_sizes.erase(size);
+    }
+
+#if LLVM_VERSION_MAJOR >= 15
+    result.block.code_ptr = symbol->toPtr<void*>();
+#else
+    result.block.code_ptr = reinterpret_cast<void*>(symbol->getAddress());
+#endif
+    result.block.end_pc = end_pc;
+    result.block.executions = 0;
+    result.block.tier = tier;
+    result.block.opt_level = level;
+    result.block.from_cache = from_cache;
+    result.block.compile_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - compile_start).count();
+    result.block.contains_branch = contains_branch;
+    result.block.trace_blocks = segments;
+    result.block.llvm_ir = std::make_shared<const std::string>(std::move(str));
+    result.state.dylib = &*dylib;
+
+    return result;
+}
+
+// The default pipelines cover what block IR needs: SROA/mem2reg, instcombine, GVN, simplifycfg and DSE
+void RV32IJIT::optimize_module(llvm::Module& module, std::uint8_t level) {
+    llvm::LoopAnalysisManager loop_analysis;
+    llvm::FunctionAnalysisManager function_analysis;
+    llvm::CGSCCAnalysisManager cgscc_analysis;
+    llvm::ModuleAnalysisManager module_analysis;
+
+    llvm::PassBuilder pass_builder;
+    pass_builder.registerModuleAnalyses(module_analysis);
+    pass_builder.registerCGSCCAnalyses(cgscc_analysis);
+    pass_builder.registerFunctionAnalyses(function_analysis);
+    pass_builder.registerLoopAnalyses(loop_analysis);
+    pass_builder.crossRegisterProxies(loop_analysis, function_analysis, cgscc_analysis, module_analysis);
+
+    static const llvm::OptimizationLevel levels[] = {
+        llvm::OptimizationLevel::O0, llvm::OptimizationLevel::O1, llvm::OptimizationLevel::O2, llvm::OptimizationLevel::O3
+    };
+
+    llvm::ModulePassManager passes = pass_builder.buildPerModuleDefaultPipeline(levels[level]);
+    passes.run(module, module_analysis);
+}
+
+RV32IJIT::BlockEntry* RV32IJIT::block_entry(uint32_t pc, bool create) {
+    // Addresses below RAM wrap around past its end, JIT code indexes the table the same way
+    uint32_t offset = pc - RAM_BASE;
+    if (offset >= state.memory_size || (pc & 3)) {
+        return nullptr;
+    }
+
+    BlockEntry*& page = block_directory[offset >> CODE_PAGE_SHIFT];
+    if (!page) {
+        if (!create) {
+            return nullptr;
+        }
+
+        block_pages.push_back(std::make_unique<BlockEntry[]>(CODE_PAGE_SIZE / 4));
+        page = block_pages.back().get();
+    }
+
+    return &page[(offset & (CODE_PAGE_SIZE - 1)) >> 2];
+}
+
+CompiledBlock* RV32IJIT::find_block(uint32_t pc) {
+    auto it = block_cache.find(pc);
+    if (it != block_cache.end()) {
+        return &it->second;
+    }
+    return nullptr;
+}
+
+void RV32IJIT::evict_block() {
+    // CLOCK: a block that ran since the hand last passed, chained or not, gets another lap
+    while (!clock_ring.empty()) {
+        if (clock_hand == clock_ring.end()) {
+            clock_hand = clock_ring.begin();
+        }
+
+        uint32_t pc = *clock_hand;
+        BlockState& state = block_states[pc];
+
+        if (state.runtime->executions != state.clock_executions) {
+            state.clock_executions = state.runtime->executions;
+            ++clock_hand;
+            continue;
+        }
+
+        discard_block(pc);
+        return;
+    }
+}
+
+void RV32IJIT::record_code_sizes(const llvm::MemoryBuffer& object) {
+    auto file = llvm::object::ObjectFile::createObjectFile(object.getMemBufferRef());
+    if (!file) {
+        llvm::consumeError(file.takeError());
+        return;
+    }
+
+    for (const auto& [symbol, size] : llvm::object::computeSymbolSizes(**file)) {
+        auto type = symbol.getType();
+        if (!type || *type != llvm::object::SymbolRef::ST_Function) {
+            if (!type) llvm::consumeError(type.takeError());
+            continue;
+        }
+
+        auto name = symbol.getName();
+        if (!name) {
+            llvm::consumeError(name.takeError());
+            continue;
+        }
+
+        code_sizes[name->str()] = size;
+    }
+}
+
+void RV32IJIT::no_ext(std::string extension) {
+	std::ostringstream logMessage;
+	logMessage << "FATAL ERROR: Called a " << extension.c_str() << " extension opcode but it's unavailable for this core!";
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+}
+
+void RV32IJIT::unknown_rv16_opcode(std::uint16_t opcode) {
+    std::ostringstream logMessage;
+    logMessage << "Unimplemented LLVM IR RV16 Opcode: 0x" << format("{:04X}", opcode);
+
+    Logger::error(logMessage.str());
+
+    Risky::exit(1, Risky::Subsystem::Core);
+}
+
+void RV32IJIT::unknown_rv32_opcode(std::uint32_t opcode) {
+    std::ostringstream logMessage;
+    logMessage << "Unimplemented LLVM IR RV32 Opcode: 0x" << format("{:08X}", opcode);
+
+    Logger::error(logMessage.str());
+
+    Risky::exit(1, Risky::Subsystem::Core);
+}
+
+void RV32IJIT::unknown_branch_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented LLVM IR BRANCH opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+}
+
+void RV32IJIT::unknown_zicsr_opcode(std::uint8_t funct3) {
+	std::ostringstream logMessage;
+	logMessage << "Unimplemented LLVM IR Zicsr opcode: 0b" << format("{:08b}", funct3);
+
+	Logger::error(logMessage.str());
+
+	Risky::exit(1, Risky::Subsystem::Core);
+}
+
+std::tuple<bool, uint32_t, bool> RV32IJIT::generate_ir_for_opcode(uint32_t opcode, uint32_t current_pc) {
+    bool is_branch = false;
+    bool error = false;
+
+    std::uint8_t opcode_rv32 = opcode & 0x7F;
+    std::uint8_t funct3 = (opcode >> 12) & 0x7;
+
+    OpcodeHandler handler = nullptr;
+
+    auto opcode_it = opcode_table.find(opcode_rv32);
+    if (opcode_it != opcode_table.end()) {
+        if (opcode_it->second.single_handler) {
+            handler = opcode_it->second.single_handler;
+        } else {
+            auto funct3_it = opcode_it->second.funct3_map.find(funct3);
+            if (funct3_it != opcode_it->second.funct3_map.end()) {
+                handler = funct3_it->second;
+            }
+        }
+    }
+
+    // Handlers refuse before emitting anything, so a refused opcode leaves the block intact
+    if (!handler || !(this->*handler)(opcode, current_pc, core)) {
+        error = true;
+    } else {
+        is_branch = opcode_rv32 == BRANCH || opcode_rv32 == JAL || opcode_rv32 == JALR;
+    }
+
+    return {is_branch, current_pc, error};
+}
+
+// Immediate decoding, sign-extended like the interpreter's decoder
+static std::int32_t imm_i(std::uint32_t opcode) {
+    return static_cast<std::int32_t>(opcode) >> 20;
+}
+
+static std::int32_t imm_s(std::uint32_t opcode) {
+    return (static_cast<std::int32_t>(opcode & 0xFE000000) >> 20) | ((opcode >> 7) & 0x1F);
+}
+
+static std::int32_t imm_b(std::uint32_t opcode) {
+    std::int32_t imm = ((opcode >> 7) & 0x1E) | ((opcode >> 20) & 0x7E0) | ((opcode << 4) & 0x800) | ((opcode >> 19) & 0x1000);
+    return (imm << 19) >> 19;
+}
+
+static std::int32_t imm_j(std::uint32_t opcode) {
+    std::int32_t imm = ((opcode >> 20) & 0x7FE) | ((opcode >> 9) & 0x800) | (opcode & 0xFF000) | ((opcode >> 11) & 0x100000);
+    return (imm << 11) >> 11;
+}
+
+// Memory goes through the bus so MMIO and code write tracking behave like the interpreter
+// x1 and x5 are the link registers calls and returns are told apart by
+static bool is_link_register(std::uint8_t reg) {
+    return reg == 1 || reg == 5;
+}
+
+static std::uint32_t jit_read8(Bus* bus, std::uint32_t address) {
+    return bus->read8(address);
+}
+
+static std::uint32_t jit_read16(Bus* bus, std::uint32_t address) {
+    return bus->read8(address) | (bus->read8(address + 1) << 8);
+}
+
+static std::uint32_t jit_read32(Bus* bus, std::uint32_t address) {
+    return bus->read32(address);
+}
+
+static void jit_write8(Bus* bus, std::uint32_t address, std::uint32_t value) {
+    bus->write8(address, value & 0xFF);
+}
+
+static void jit_write16(Bus* bus, std::uint32_t address, std::uint32_t value) {
+    bus->write8(address, value & 0xFF);
+    bus->write8(address + 1, (value >> 8) & 0xFF);
+}
+
+static void jit_write32(Bus* bus, std::uint32_t address, std::uint32_t value) {
+    bus->write32(address, value);
+}
+
+void RV32IJIT::register_helpers() {
+    const std::pair<const char*, void*> helpers[] = {
+        {"risky_read8", reinterpret_cast<void*>(&jit_read8)},
+        {"risky_read16", reinterpret_cast<void*>(&jit_read16)},
+        {"risky_read32", reinterpret_cast<void*>(&jit_read32)},
+        {"risky_write8", reinterpret_cast<void*>(&jit_write8)},
+        {"risky_write16", reinterpret_cast<void*>(&jit_write16)},
+        {"risky_write32", reinterpret_cast<void*>(&jit_write32)},
+    };
+
+    llvm::orc::SymbolMap symbols;
+    for (const auto& [name, address] : helpers) {
+#if LLVM_VERSION_MAJOR >= 17
+        symbols[jit->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+            llvm::orc::ExecutorAddr::fromPtr(address), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+#else
+        symbols[jit->mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(address), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+#endif
+    }
+
+    if (auto err = jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols)))) {
+        Logger::error("Failed to register JIT helpers: " + llvm::toString(std::move(err)));
+    }
+}
+
+llvm::Value* RV32IJIT::field_pointer(llvm::Value* base, std::size_t offset, llvm::Type* type) {
+    llvm::Value *field = builder->CreateConstInBoundsGEP1_64(builder->getInt8Ty(), base, offset);
+    return builder->CreateBitCast(field, llvm::PointerType::getUnqual(type));
+}
+
+llvm::Value* RV32IJIT::runtime_field(std::size_t offset, llvm::Type* type) {
+    return field_pointer(runtime_arg, offset, type);
+}
+
+// Blocks only fork around a memory access and join right after it, so a value defined on first use dominates every later one
+llvm::Value* RV32IJIT::load_register(std::uint8_t reg) {
+    if (reg == 0) {
+        return builder->getInt32(0);
+    }
+
+    if (registers_in_slots) {
+        return builder->CreateLoad(builder->getInt32Ty(), register_slot(reg), "x" + std::to_string(reg));
+    }
+
+    if (!register_values[reg]) {
+        llvm::Value *reg_ptr = builder->CreateGEP(builder->getInt32Ty(), state_fields[STATE_REGISTERS], builder->getInt32(reg));
+        register_values[reg] = builder->CreateLoad(builder->getInt32Ty(), reg_ptr, "x" + std::to_string(reg));
+    }
+
+    return register_values[reg];
+}
+
+void RV32IJIT::store_register(std::uint8_t reg, llvm::Value* value) {
+    if (reg == 0) {
+        return;
+    }
+
+    if (registers_in_slots) {
+        builder->CreateStore(value, register_slot(reg));
+    } else {
+        register_values[reg] = value;
+    }
+    dirty_registers |= 1u << reg;
+}
+
+llvm::AllocaInst* RV32IJIT::register_slot(std::uint8_t reg) {
+    if (!register_slots[reg]) {
+        // Filled from the guest register before the loop starts, so every path through it sees a value
+        llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+        builder->SetInsertPoint(entry_block->getTerminator());
+        register_slots[reg] = builder->CreateAlloca(builder->getInt32Ty(), nullptr, "x" + std::to_string(reg) + "_slot");
+        llvm::Value *reg_ptr = builder->CreateGEP(builder->getInt32Ty(), state_fields[STATE_REGISTERS], builder->getInt32(reg));
+        builder->CreateStore(builder->CreateLoad(builder->getInt32Ty(), reg_ptr), register_slots[reg]);
+    }
+
+    return register_slots[reg];
+}
+
+void RV32IJIT::flush_registers() {
+    if (registers_in_slots) {
+        deferred_flushes.push_back(mark_position());
+        return;
+    }
+
+    store_dirty_registers();
+}
+
+void RV32IJIT::store_dirty_registers() {
+    for (std::uint8_t reg = 1; reg < 32; reg++) {
+        if (dirty_registers & (1u << reg)) {
+            llvm::Value *value = registers_in_slots
+                ? builder->CreateLoad(builder->getInt32Ty(), register_slots[reg])
+                : register_values[reg];
+            llvm::Value *reg_ptr = builder->CreateGEP(builder->getInt32Ty(), state_fields[STATE_REGISTERS], builder->getInt32(reg));
+            builder->CreateStore(value, reg_ptr);
+        }
+    }
+}
+
+RV32IJIT::InsertMark RV32IJIT::mark_position() {
+    llvm::BasicBlock *block = builder->GetInsertBlock();
+    return {block, block->empty() ? nullptr : &block->back()};
+}
+
+void RV32IJIT::insert_at(const InsertMark& mark) {
+    if (mark.second) {
+        builder->SetInsertPoint(mark.second->getNextNode());
+    } else {
+        builder->SetInsertPoint(mark.first, mark.first->getFirstInsertionPt());
+    }
+}
+
+void RV32IJIT::store_pc(llvm::Value* pc) {
+    builder->CreateStore(pc, state_fields[STATE_PC]);
+}
+
+void RV32IJIT::emit_exit(uint32_t target_pc) {
+    llvm::Function *func = builder->GetInsertBlock()->getParent();
+
+    // The trace goes on in this same function, every hot exit of a segment joins up in hot_path
+    if (hot_successor && *hot_successor == target_pc) {
+        if (!hot_path) {
+            hot_path = llvm::BasicBlock::Create(builder->getContext(), "hot", func);
+        }
+        builder->CreateBr(hot_path);
+        return;
+    }
+
+    flush_registers();
+
+    if (current_runtime->link_count == MAX_BLOCK_EXITS) {
+        emit_return(builder->getInt32(target_pc), builder->getInt32(uint32_t(BlockExit::Unlinked)));
+        return;
+    }
+
+    uint8_t slot = current_runtime->link_count++;
+    current_runtime->targets[slot] = target_pc;
+
+    // Tier 1 counts where it leaves, select_trace() builds traces out of that
+    if (current_tier == 1) {
+        llvm::Value *count_ptr = runtime_field(offsetof(BlockRuntime, exit_counts) + slot * sizeof(uint64_t), builder->getInt64Ty());
+        builder->CreateStore(builder->CreateAdd(builder->CreateLoad(builder->getInt64Ty(), count_ptr), builder->getInt64(1)), count_ptr);
+    }
+    llvm::Type *block_ptr_type = llvm::PointerType::getUnqual(func->getFunctionType());
+
+    llvm::Value *next = builder->CreateLoad(block_ptr_type, runtime_field(offsetof(BlockRuntime, next) + slot * sizeof(void*), block_ptr_type));
+    llvm::Value *budget = builder->CreateLoad(builder->getInt64Ty(), chain_budget_pointer());
+
+    llvm::BasicBlock *linked = llvm::BasicBlock::Create(builder->getContext(), "linked", func);
+    llvm::BasicBlock *chain = llvm::BasicBlock::Create(builder->getContext(), "chain", func);
+    llvm::BasicBlock *leave = llvm::BasicBlock::Create(builder->getContext(), "leave", func);
+    builder->CreateCondBr(builder->CreateICmpNE(next, llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(block_ptr_type))),
+        linked, leave);
+
+    // A successor that could run past the budget is left to dispatch(), run(n) never retires more than n
+    builder->SetInsertPoint(linked);
+    llvm::Type *runtime_ptr_type = runtime_arg->getType();
+    llvm::Value *next_runtime = builder->CreateLoad(runtime_ptr_type,
+        runtime_field(offsetof(BlockRuntime, next_runtime) + slot * sizeof(BlockRuntime*), runtime_ptr_type));
+    builder->CreateCondBr(budget_covers(budget, next_runtime), chain, leave);
+
+    // musttail keeps a long chain from growing the host stack
+    builder->SetInsertPoint(chain);
+    llvm::CallInst *call = builder->CreateCall(func->getFunctionType(), next, {state_arg, next_runtime});
+    call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    builder->CreateRet(call);
+
+    builder->SetInsertPoint(leave);
+    emit_return(builder->getInt32(target_pc), builder->CreateSelect(builder->CreateICmpSGT(budget, builder->getInt64(0)),
+        builder->getInt32(uint32_t(BlockExit::Unlinked)), builder->getInt32(uint32_t(BlockExit::BudgetExhausted))));
+}
+
+void RV32IJIT::emit_return(llvm::Value* pc, llvm::Value* reason) {
+    // The interpreter and everything else outside JIT code still go by core->pc
+    store_pc(pc);
+    llvm::Value *exit = builder->CreateOr(
+        builder->CreateShl(builder->CreateZExt(reason, builder->getInt64Ty()), 32),
+        builder->CreateZExt(pc, builder->getInt64Ty()));
+    builder->CreateRet(exit);
+}
+
+void RV32IJIT::emit_indirect_exit(llvm::Value* target) {
+    flush_registers();
+
+    llvm::Function *func = builder->GetInsertBlock()->getParent();
+    llvm::LLVMContext &context = builder->getContext();
+    llvm::Type *i8_ptr = llvm::PointerType::getUnqual(builder->getInt8Ty());
+    llvm::Type *block_ptr_type = llvm::PointerType::getUnqual(func->getFunctionType());
+    llvm::Type *runtime_ptr_type = runtime_arg->getType();
+
+    // Popped before anything is pushed, jalr ra, 0(ra) returns from one call and makes the next
+    llvm::Value *predicted_pc = nullptr;
+    llvm::Value *predicted_slot = nullptr;
+    llvm::Value *predicted_runtime = nullptr;
+    if (jump_pops_return) {
+        llvm::Value *stack = state_fields[STATE_RETURN_STACK];
+        llvm::Value *top_ptr = field_pointer(stack, offsetof(ReturnStack, top), builder->getInt32Ty());
+        llvm::Value *top = builder->CreateLoad(builder->getInt32Ty(), top_ptr);
+        llvm::Value *entry = builder->CreateGEP(builder->getInt8Ty(), stack, builder->CreateAdd(
+            builder->getInt64(offsetof(ReturnStack, entries)),
+            builder->CreateMul(builder->CreateZExt(top, builder->getInt64Ty()), builder->getInt64(sizeof(ReturnEntry)))));
+        predicted_pc = builder->CreateLoad(builder->getInt32Ty(), field_pointer(entry, offsetof(ReturnEntry, pc), builder->getInt32Ty()));
+        predicted_slot = builder->CreateLoad(builder->getInt32Ty(), field_pointer(entry, offsetof(ReturnEntry, slot), builder->getInt32Ty()));
+        predicted_runtime = builder->CreateLoad(runtime_ptr_type, field_pointer(entry, offsetof(ReturnEntry, runtime), runtime_ptr_type));
+        builder->CreateStore(builder->CreateAnd(builder->CreateSub(top, builder->getInt32(1)), builder->getInt32(RETURN_STACK_SIZE - 1)), top_ptr);
+    }
+
+    if (jump_pushes_return) {
+        push_return(*jump_pushes_return);
+    }
+
+    llvm::Value *budget = builder->CreateLoad(builder->getInt64Ty(), chain_budget_pointer());
+    llvm::Value *has_budget = builder->CreateICmpSGT(budget, builder->getInt64(0));
+
+    llvm::BasicBlock *cache_check = llvm::BasicBlock::Create(context, "cache_check", func);
+    llvm::BasicBlock *cache_hit = llvm::BasicBlock::Create(context, "cache_hit", func);
+    llvm::BasicBlock *table_check = llvm::BasicBlock::Create(context, "table_check", func);
+    llvm::BasicBlock *page_probe = llvm::BasicBlock::Create(context, "page_probe", func);
+    llvm::BasicBlock *entry_probe = llvm::BasicBlock::Create(context, "entry_probe", func);
+    llvm::BasicBlock *table_hit = llvm::BasicBlock::Create(context, "table_hit", func);
+    llvm::BasicBlock *chain = llvm::BasicBlock::Create(context, "indirect_chain", func);
+    llvm::BasicBlock *leave = llvm::BasicBlock::Create(context, "leave", func);
+
+    // The caller's continuation slot is linked like any other exit, so it's null until that block is compiled
+    llvm::BasicBlock *return_hit = nullptr;
+    llvm::Value *return_next = nullptr;
+    llvm::Value *return_next_runtime = nullptr;
+    if (jump_pops_return) {
+        return_hit = llvm::BasicBlock::Create(context, "return_hit", func, cache_check);
+        llvm::Value *predicted = builder->CreateAnd(builder->CreateAnd(
+            builder->CreateICmpEQ(predicted_pc, target), builder->CreateIsNotNull(predicted_runtime)), has_budget);
+        builder->CreateCondBr(predicted, return_hit, cache_check);
+
+        builder->SetInsertPoint(return_hit);
+        llvm::Value *slot_offset = builder->CreateZExt(predicted_slot, builder->getInt64Ty());
+        llvm::Value *caller = builder->CreateBitCast(predicted_runtime, i8_ptr);
+        return_next = builder->CreateLoad(block_ptr_type, builder->CreateBitCast(
+            builder->CreateGEP(builder->getInt8Ty(), caller, builder->CreateAdd(builder->getInt64(offsetof(BlockRuntime, next)),
+                builder->CreateMul(slot_offset, builder->getInt64(sizeof(void*))))), llvm::PointerType::getUnqual(block_ptr_type)));
+        return_next_runtime = builder->CreateLoad(runtime_ptr_type, builder->CreateBitCast(
+            builder->CreateGEP(builder->getInt8Ty(), caller, builder->CreateAdd(builder->getInt64(offsetof(BlockRuntime, next_runtime)),
+                builder->CreateMul(slot_offset, builder->getInt64(sizeof(BlockRuntime*))))), llvm::PointerType::getUnqual(runtime_ptr_type)));
+        builder->CreateCondBr(builder->CreateIsNotNull(return_next), chain, cache_check);
+    } else {
+        builder->CreateBr(cache_check);
+    }
+
+    // Whatever this jalr went to last time, the entry is cleared when that block goes away
+    builder->SetInsertPoint(cache_check);
+    llvm::Value *cache_entry_ptr = runtime_field(offsetof(BlockRuntime, indirect_entry), i8_ptr);
+    llvm::Value *cache_entry = builder->CreateLoad(i8_ptr, cache_entry_ptr);
+    llvm::Value *cache_target_ptr = runtime_field(offsetof(BlockRuntime, indirect_target), builder->getInt32Ty());
+    llvm::Value *cached = builder->CreateAnd(builder->CreateAnd(
+        builder->CreateICmpEQ(builder->CreateLoad(builder->getInt32Ty(), cache_target_ptr), target),
+        builder->CreateIsNotNull(cache_entry)), has_budget);
+    builder->CreateCondBr(cached, cache_hit, table_check);
+
+    builder->SetInsertPoint(cache_hit);
+    llvm::Value *cache_next = builder->CreateLoad(block_ptr_type, field_pointer(cache_entry, offsetof(BlockEntry, code), block_ptr_type));
+    llvm::Value *cache_next_runtime = builder->CreateLoad(runtime_ptr_type, field_pointer(cache_entry, offsetof(BlockEntry, runtime), runtime_ptr_type));
+    builder->CreateCondBr(builder->CreateIsNotNull(cache_next), chain, table_check);
+
+    // Same lookup as block_entry(), a miss or a misaligned target goes back to dispatch() to be sorted out
+    builder->SetInsertPoint(table_check);
+    llvm::Value *offset = builder->CreateSub(target, builder->getInt32(RAM_BASE));
+    llvm::Value *in_ram = builder->CreateAnd(
+        builder->CreateICmpULT(offset, state_fields[STATE_MEMORY_SIZE]),
+        builder->CreateICmpEQ(builder->CreateAnd(target, builder->getInt32(3)), builder->getInt32(0)));
+    builder->CreateCondBr(builder->CreateAnd(in_ram, has_budget), page_probe, leave);
+
+    builder->SetInsertPoint(page_probe);
+    llvm::Value *page_index = builder->CreateZExt(builder->CreateLShr(offset, builder->getInt32(CODE_PAGE_SHIFT)), builder->getInt64Ty());
+    llvm::Value *page = builder->CreateLoad(i8_ptr, builder->CreateGEP(i8_ptr, state_fields[STATE_BLOCK_DIRECTORY], page_index));
+    builder->CreateCondBr(builder->CreateIsNotNull(page), entry_probe, leave);
+
+    builder->SetInsertPoint(entry_probe);
+    llvm::Value *slot = builder->CreateLShr(builder->CreateAnd(offset, builder->getInt32(CODE_PAGE_SIZE - 1)), builder->getInt32(2));
+    llvm::Value *entry = builder->CreateGEP(builder->getInt8Ty(), page,
+        builder->CreateMul(builder->CreateZExt(slot, builder->getInt64Ty()), builder->getInt64(sizeof(BlockEntry))));
+    llvm::Value *table_next = builder->CreateLoad(block_ptr_type, field_pointer(entry, offsetof(BlockEntry, code), block_ptr_type));
+    builder->CreateCondBr(builder->CreateIsNotNull(table_next), table_hit, leave);
+
+    builder->SetInsertPoint(table_hit);
+    llvm::Value *table_next_runtime = builder->CreateLoad(runtime_ptr_type, field_pointer(entry, offsetof(BlockEntry, runtime), runtime_ptr_type));
+    builder->CreateStore(target, cache_target_ptr);
+    builder->CreateStore(entry, cache_entry_ptr);
+    builder->CreateBr(chain);
+
+    builder->SetInsertPoint(chain);
+    llvm::PHINode *next = builder->CreatePHI(block_ptr_type, 3);
+    llvm::PHINode *next_runtime = builder->CreatePHI(runtime_ptr_type, 3);
+    if (return_hit) {
+        next->addIncoming(return_next, return_hit);
+        next_runtime->addIncoming(return_next_runtime, return_hit);
+    }
+    next->addIncoming(cache_next, cache_hit);
+    next_runtime->addIncoming(cache_next_runtime, cache_hit);
+    next->addIncoming(table_next, table_hit);
+    next_runtime->addIncoming(table_next_runtime, table_hit);
+
+    // Same as a direct exit, the target has to fit in what's left of the budget
+    llvm::BasicBlock *call_next = llvm::BasicBlock::Create(context, "indirect_call", func);
+    builder->CreateCondBr(budget_covers(budget, next_runtime), call_next, leave);
+
+    // musttail keeps a long chain from growing the host stack
+    builder->SetInsertPoint(call_next);
+    llvm::CallInst *call = builder->CreateCall(func->getFunctionType(), next, {state_arg, next_runtime});
+    call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    builder->CreateRet(call);
+
+    builder->SetInsertPoint(leave);
+    emit_return(target, builder->CreateSelect(has_budget,
+        builder->getInt32(uint32_t(BlockExit::Indirect)), builder->getInt32(uint32_t(BlockExit::BudgetExhausted))));
+}
+
+void RV32IJIT::push_return(uint32_t return_pc) {
+    // The return gets a link slot of its own, no exit is emitted for it and tier 1 never counts it
+    uint32_t slot = MAX_BLOCK_EXITS;
+    if (current_runtime->link_count < MAX_BLOCK_EXITS) {
+        slot = current_runtime->link_count++;
+        current_runtime->targets[slot] = return_pc;
+    }
+
+    llvm::Value *stack = state_fields[STATE_RETURN_STACK];
+    llvm::Value *top_ptr = field_pointer(stack, offsetof(ReturnStack, top), builder->getInt32Ty());
+    llvm::Value *top = builder->CreateAnd(builder->CreateAdd(builder->CreateLoad(builder->getInt32Ty(), top_ptr), builder->getInt32(1)),
+        builder->getInt32(RETURN_STACK_SIZE - 1));
+    builder->CreateStore(top, top_ptr);
+
+    // Out of slots still pushes, with no runtime the matching return just misses
+    llvm::Type *runtime_ptr_type = runtime_arg->getType();
+    llvm::Value *entry = builder->CreateGEP(builder->getInt8Ty(), stack, builder->CreateAdd(
+        builder->getInt64(offsetof(ReturnStack, entries)),
+        builder->CreateMul(builder->CreateZExt(top, builder->getInt64Ty()), builder->getInt64(sizeof(ReturnEntry)))));
+    builder->CreateStore(builder->getInt32(return_pc), field_pointer(entry, offsetof(ReturnEntry, pc), builder->getInt32Ty()));
+    builder->CreateStore(builder->getInt32(slot == MAX_BLOCK_EXITS ? 0 : slot), field_pointer(entry, offsetof(ReturnEntry, slot), builder->getInt32Ty()));
+    builder->CreateStore(slot == MAX_BLOCK_EXITS ? llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(runtime_ptr_type)) : runtime_arg,
+        field_pointer(entry, offsetof(ReturnEntry, runtime), runtime_ptr_type));
+}
+
+llvm::Value* RV32IJIT::call_helper(const char* name, llvm::Type* return_type, std::initializer_list<llvm::Value*> args) {
+    std::vector<llvm::Type*> arg_types;
+    for (llvm::Value* arg : args) {
+        arg_types.push_back(arg->getType());
+    }
+
+    llvm::Module* module = builder->GetInsertBlock()->getModule();
+    llvm::FunctionCallee callee = module->getOrInsertFunction(name, llvm::FunctionType::get(return_type, arg_types, false));
+    return builder->CreateCall(callee, args);
+}
+
+llvm::Value* RV32IJIT::ram_offset(llvm::Value* address, unsigned width, llvm::Value*& in_ram) {
+    // Addresses below RAM wrap around to huge offsets, so one unsigned compare checks both ends
+    llvm::Value *offset = builder->CreateSub(address, builder->getInt32(RAM_BASE));
+    in_ram = builder->CreateICmpULE(offset, builder->CreateSub(state_fields[STATE_MEMORY_SIZE], builder->getInt32(width)));
+    return offset;
+}
+
+llvm::Value* RV32IJIT::emit_read(llvm::Value* address, unsigned width) {
+    llvm::Value *in_ram = nullptr;
+    llvm::Value *offset = ram_offset(address, width, in_ram);
+
+    llvm::Function *func = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock *ram = llvm::BasicBlock::Create(builder->getContext(), "ram_read", func);
+    llvm::BasicBlock *bus = llvm::BasicBlock::Create(builder->getContext(), "bus_read", func);
+    llvm::BasicBlock *done = llvm::BasicBlock::Create(builder->getContext(), "read_done", func);
+    builder->CreateCondBr(in_ram, ram, bus, llvm::MDBuilder(builder->getContext()).createBranchWeights(RAM_ACCESS_WEIGHT, 1));
+
+    // Guest accesses can be misaligned, the host doesn't mind as long as LLVM is told
+    builder->SetInsertPoint(ram);
+    llvm::Type *type = builder->getIntNTy(width * 8);
+    llvm::Value *host = builder->CreateGEP(builder->getInt8Ty(), state_fields[STATE_MEMORY], builder->CreateZExt(offset, builder->getInt64Ty()));
+    llvm::Value *ram_value = builder->CreateAlignedLoad(type, builder->CreateBitCast(host, llvm::PointerType::getUnqual(type)), llvm::MaybeAlign(1));
+    ram_value = builder->CreateZExt(ram_value, builder->getInt32Ty());
+    builder->CreateBr(done);
+
+    builder->SetInsertPoint(bus);
+    const char* helper = width == 1 ? "risky_read8" : width == 2 ? "risky_read16" : "risky_read32";
+    llvm::Value *bus_value = call_helper(helper, builder->getInt32Ty(), {bus_pointer(), address});
+    builder->CreateBr(done);
+
+    builder->SetInsertPoint(done);
+    llvm::PHINode *value = builder->CreatePHI(builder->getInt32Ty(), 2);
+    value->addIncoming(ram_value, ram);
+    value->addIncoming(bus_value, bus);
+    return value;
+}
+
+void RV32IJIT::emit_write(llvm::Value* address, llvm::Value* value, unsigned width) {
+    llvm::Value *in_ram = nullptr;
+    llvm::Value *offset = ram_offset(address, width, in_ram);
+
+    llvm::Function *func = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock *check = llvm::BasicBlock::Create(builder->getContext(), "code_check", func);
+    llvm::BasicBlock *ram = llvm::BasicBlock::Create(builder->getContext(), "ram_write", func);
+    llvm::BasicBlock *bus = llvm::BasicBlock::Create(builder->getContext(), "bus_write", func);
+    llvm::BasicBlock *done = llvm::BasicBlock::Create(builder->getContext(), "write_done", func);
+    llvm::MDNode *likely = llvm::MDBuilder(builder->getContext()).createBranchWeights(RAM_ACCESS_WEIGHT, 1);
+    builder->CreateCondBr(in_ram, check, bus, likely);
+
+    // Stores to pages something decoded code from go through the bus, so every backend hears about them
+    builder->SetInsertPoint(check);
+    llvm::Value *flags = state_fields[STATE_CODE_PAGES];
+    auto page_flag = [&](llvm::Value* page_offset) {
+        llvm::Value *page = builder->CreateZExt(builder->CreateLShr(page_offset, builder->getInt32(CODE_PAGE_SHIFT)), builder->getInt64Ty());
+        return builder->CreateLoad(builder->getInt8Ty(), builder->CreateGEP(builder->getInt8Ty(), flags, page));
+    };
+    llvm::Value *code = page_flag(offset);
+    if (width > 1) {
+        code = builder->CreateOr(code, page_flag(builder->CreateAdd(offset, builder->getInt32(width - 1))));
+    }
+    builder->CreateCondBr(builder->CreateICmpEQ(code, builder->getInt8(0)), ram, bus, likely);
+
+    builder->SetInsertPoint(ram);
+    llvm::Type *type = builder->getIntNTy(width * 8);
+    llvm::Value *host = builder->CreateGEP(builder->getInt8Ty(), state_fields[STATE_MEMORY], builder->CreateZExt(offset, builder->getInt64Ty()));
+    builder->CreateAlignedStore(builder->CreateTrunc(value, type), builder->CreateBitCast(host, llvm::PointerType::getUnqual(type)), llvm::MaybeAlign(1));
+    builder->CreateBr(done);
+
+    builder->SetInsertPoint(bus);
+    const char* helper = width == 1 ? "risky_write8" : width == 2 ? "risky_write16" : "risky_write32";
+    call_helper(helper, builder->getVoidTy(), {bus_pointer(), address, value});
+    builder->CreateBr(done);
+
+    builder->SetInsertPoint(done);
+}
+
+llvm::Value* RV32IJIT::bus_pointer() {
+    return state_fields[STATE_BUS];
+}
+
+llvm::Value* RV32IJIT::chain_budget_pointer() {
+    return builder->CreateStructGEP(state_type, state_arg, STATE_CHAIN_BUDGET);
+}
+
+llvm::Value* RV32IJIT::budget_covers(llvm::Value* budget, llvm::Value* runtime) {
+    llvm::Value *instructions = builder->CreateLoad(builder->getInt32Ty(),
+        field_pointer(runtime, offsetof(BlockRuntime, max_instructions), builder->getInt32Ty()));
+    return builder->CreateICmpSGE(budget, builder->CreateZExt(instructions, builder->getInt64Ty()));
+}
+
+// LUI / AUIPC
+bool RV32IJIT::rv32i_lui(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    store_register((opcode >> 7) & 0x1F, builder->getInt32(opcode & 0xFFFFF000));
+
+    current_pc += 4;
+    return true;
+}
+
+bool RV32IJIT::rv32i_auipc(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    store_register((opcode >> 7) & 0x1F, builder->getInt32(current_pc + (opcode & 0xFFFFF000)));
+
+    current_pc += 4;
+    return true;
+}
+
+// JAL / JALR
+bool RV32IJIT::rv32i_jal(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    uint8_t rd = (opcode >> 7) & 0x1F;
+    store_register(rd, builder->getInt32(current_pc + 4));
+    if (is_link_register(rd)) {
+        push_return(current_pc + 4);
+    }
+    emit_exit(current_pc + imm_j(opcode));
+
+    current_pc += 4;
+    return true;
+}
+
+bool RV32IJIT::rv32i_jalr(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    // Work out the target before rd is written, rd and rs1 can be the same register
+    llvm::Value *target = builder->CreateAdd(load_register((opcode >> 15) & 0x1F), builder->getInt32(imm_i(opcode)));
+    target = builder->CreateAnd(target, builder->getInt32(~1u));
+
+    uint8_t rd = (opcode >> 7) & 0x1F;
+    uint8_t rs1 = (opcode >> 15) & 0x1F;
+    store_register(rd, builder->getInt32(current_pc + 4));
+    jump_target = target;
+
+    // Return address stack hints from the unprivileged spec, table 2.1
+    jump_pops_return = is_link_register(rs1) && (!is_link_register(rd) || rd != rs1);
+    jump_pushes_return.reset();
+    if (is_link_register(rd)) {
+        jump_pushes_return = current_pc + 4;
+    }
+
+    current_pc += 4;
+    return true;
+}
+
+// BRANCH
+bool RV32IJIT::emit_branch(std::uint32_t opcode, uint32_t& current_pc, llvm::CmpInst::Predicate predicate) {
+    llvm::Value *rs1_val = load_register((opcode >> 15) & 0x1F);
+    llvm::Value *rs2_val = load_register((opcode >> 20) & 0x1F);
+
+    // Both ways out are static, so each one gets its own link slot
+    llvm::Value *cond = builder->CreateICmp(predicate, rs1_val, rs2_val);
+
+    llvm::Function *func = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock *taken = llvm::BasicBlock::Create(builder->getContext(), "taken", func);
+    llvm::BasicBlock *not_taken = llvm::BasicBlock::Create(builder->getContext(), "not_taken", func);
+    builder->CreateCondBr(cond, taken, not_taken);
+
+    builder->SetInsertPoint(taken);
+    emit_exit(current_pc + imm_b(opcode));
+
+    builder->SetInsertPoint(not_taken);
+    emit_exit(current_pc + 4);
+
+    current_pc += 4;
+    return true;
+}
+
+bool RV32IJIT::rv32i_beq(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_branch(opcode, current_pc, llvm::CmpInst::ICMP_EQ);
+}
+
+bool RV32IJIT::rv32i_bne(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_branch(opcode, current_pc, llvm::CmpInst::ICMP_NE);
+}
+
+bool RV32IJIT::rv32i_blt(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_branch(opcode, current_pc, llvm::CmpInst::ICMP_SLT);
+}
+
+bool RV32IJIT::rv32i_bge(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_branch(opcode, current_pc, llvm::CmpInst::ICMP_SGE);
+}
+
+bool RV32IJIT::rv32i_bltu(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_branch(opcode, current_pc, llvm::CmpInst::ICMP_ULT);
+}
+
+bool RV32IJIT::rv32i_bgeu(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_branch(opcode, current_pc, llvm::CmpInst::ICMP_UGE);
+}
+
+// LOAD
+bool RV32IJIT::emit_load(std::uint32_t opcode, uint32_t& current_pc, unsigned width, bool is_signed) {
+    llvm::Value *address = builder->CreateAdd(load_register((opcode >> 15) & 0x1F), builder->getInt32(imm_i(opcode)));
+
+    llvm::Value *value = emit_read(address, width);
+
+    if (width < 4) {
+        llvm::Value *narrow = builder->CreateTrunc(value, builder->getIntNTy(width * 8));
+        value = is_signed ? builder->CreateSExt(narrow, builder->getInt32Ty()) : builder->CreateZExt(narrow, builder->getInt32Ty());
+    }
+
+    store_register((opcode >> 7) & 0x1F, value);
+
+    current_pc += 4;
+    return true;
+}
+
+bool RV32IJIT::rv32i_lb(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_load(opcode, current_pc, 1, true);
+}
+
+bool RV32IJIT::rv32i_lh(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_load(opcode, current_pc, 2, true);
+}
+
+bool RV32IJIT::rv32i_lw(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_load(opcode, current_pc, 4, true);
+}
+
+bool RV32IJIT::rv32i_lbu(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_load(opcode, current_pc, 1, false);
+}
+
+bool RV32IJIT::rv32i_lhu(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_load(opcode, current_pc, 2, false);
+}
+
+// STORE
+bool RV32IJIT::emit_store(std::uint32_t opcode, uint32_t& current_pc, unsigned width) {
+    llvm::Value *address = builder->CreateAdd(load_register((opcode >> 15) & 0x1F), builder->getInt32(imm_s(opcode)));
+
+    emit_write(address, load_register((opcode >> 20) & 0x1F), width);
+
+    current_pc += 4;
+    return true;
+}
+
+bool RV32IJIT::rv32i_sb(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_store(opcode, current_pc, 1);
+}
+
+bool RV32IJIT::rv32i_sh(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_store(opcode, current_pc, 2);
+}
+
+bool RV32IJIT::rv32i_sw(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_store(opcode, current_pc, 4);
+}
+
+// OP-IMM
+bool RV32IJIT::rv32i_op_imm(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    std::uint8_t funct3 = (opcode >> 12) & 0x7;
+    std::uint8_t funct7 = opcode >> 25;
+    llvm::Value *rs1_val = load_register((opcode >> 15) & 0x1F);
+    llvm::Value *imm = builder->getInt32(imm_i(opcode));
+    llvm::Value *shamt = builder->getInt32((opcode >> 20) & 0x1F);
+    llvm::Value *result = nullptr;
+
+    switch (funct3) {
+        case 0b000: result = builder->CreateAdd(rs1_val, imm); break;
+        case 0b010: result = builder->CreateZExt(builder->CreateICmpSLT(rs1_val, imm), builder->getInt32Ty()); break;
+        case 0b011: result = builder->CreateZExt(builder->CreateICmpULT(rs1_val, imm), builder->getInt32Ty()); break;
+        case 0b100: result = builder->CreateXor(rs1_val, imm); break;
+        case 0b110: result = builder->CreateOr(rs1_val, imm); break;
+        case 0b111: result = builder->CreateAnd(rs1_val, imm); break;
+        case 0b001:
+            if (funct7 != 0x00) return false;
+            result = builder->CreateShl(rs1_val, shamt);
+            break;
+        case 0b101:
+            if (funct7 == 0x00) {
+                result = builder->CreateLShr(rs1_val, shamt);
+            } else if (funct7 == 0x20) {
+                result = builder->CreateAShr(rs1_val, shamt);
+            } else {
+                return false;
+            }
+            break;
+    }
+
+    store_register((opcode >> 7) & 0x1F, result);
+
+    current_pc += 4;
+    return true;
+}
+
+// OP, including the M extension
+bool RV32IJIT::rv32i_op(std::uint32_t opcode, uint32_t& current_pc, RV32I* core) {
+    std::uint8_t funct3 = (opcode >> 12) & 0x7;
+    std::uint8_t funct7 = opcode >> 25;
+
+    if (funct7 != 0x00 && funct7 != 0x20 && funct7 != 0x01) return false;
+    if (funct7 == 0x20 && funct3 != 0b000 && funct3 != 0b101) return false;
+    if (funct7 == 0x01 && !core->has_m) return false;
+
+    llvm::Value *a = load_register((opcode >> 15) & 0x1F);
+    llvm::Value *b = load_register((opcode >> 20) & 0x1F);
+    llvm::Value *shamt = builder->CreateAnd(b, builder->getInt32(0x1F));
+    llvm::Value *result = nullptr;
+
+    if (funct7 == 0x01) {
+        result = emit_muldiv(funct3, a, b);
+    } else {
+        switch (funct3) {
+            case 0b000: result = funct7 == 0x20 ? builder->CreateSub(a, b) : builder->CreateAdd(a, b); break;
+            case 0b001: result = builder->CreateShl(a, shamt); break;
+            case 0b010: result = builder->CreateZExt(builder->CreateICmpSLT(a, b), builder->getInt32Ty()); break;
+            case 0b011: result = builder->CreateZExt(builder->CreateICmpULT(a, b), builder->getInt32Ty()); break;
+            case 0b100: result = builder->CreateXor(a, b); break;
+            case 0b101: result = funct7 == 0x20 ? builder->CreateAShr(a, shamt) : builder->CreateLShr(a, shamt); break;
+            case 0b110: result = builder->CreateOr(a, b); break;
+            case 0b111: result = builder->CreateAnd(a, b); break;
+        }
+    }
+
+    store_register((opcode >> 7) & 0x1F, result);
+
+    current_pc += 4;
+    return true;
+}
+
+llvm::Value* RV32IJIT::emit_muldiv(std::uint8_t funct3, llvm::Value* a, llvm::Value* b) {
+    llvm::Type *i32 = builder->getInt32Ty();
+    llvm::Type *i64 = builder->getInt64Ty();
+
+    // Division by zero and INT_MIN / -1 are defined by the ISA but not by LLVM, divide by 1 instead and pick the result after
+    llvm::Value *by_zero = builder->CreateICmpEQ(b, builder->getInt32(0));
+    llvm::Value *overflow = builder->CreateAnd(
+        builder->CreateICmpEQ(a, builder->getInt32(0x80000000)),
+        builder->CreateICmpEQ(b, builder->getInt32(0xFFFFFFFF)));
+    llvm::Value *signed_divisor = builder->CreateSelect(builder->CreateOr(by_zero, overflow), builder->getInt32(1), b);
+    llvm::Value *unsigned_divisor = builder->CreateSelect(by_zero, builder->getInt32(1), b);
+
+    switch (funct3) {
+        case 0b000: // MUL
+            return builder->CreateMul(a, b);
+        case 0b001: // MULH
+            return builder->CreateTrunc(builder->CreateLShr(builder->CreateMul(builder->CreateSExt(a, i64), builder->CreateSExt(b, i64)), 32), i32);
+        case 0b010: // MULHSU
+            return builder->CreateTrunc(builder->CreateLShr(builder->CreateMul(builder->CreateSExt(a, i64), builder->CreateZExt(b, i64)), 32), i32);
+        case 0b011: // MULHU
+            return builder->CreateTrunc(builder->CreateLShr(builder->CreateMul(builder->CreateZExt(a, i64), builder->CreateZExt(b, i64)), 32), i32);
+        case 0b100: // DIV
+            return builder->CreateSelect(by_zero, builder->getInt32(0xFFFFFFFF),
+                builder->CreateSelect(overflow, a, builder->CreateSDiv(a, signed_divisor)));
+        case 0b101: // DIVU
+            return builder->CreateSelect(by_zero, builder->getInt32(0xFFFFFFFF), builder->CreateUDiv(a, unsigned_divisor));
+        case 0b110: // REM
+            return builder->CreateSelect(by_zero, a,
+                builder->CreateSelect(overflow, builder->getInt32(0), builder->CreateSRem(a, signed_divisor)));
+        default: // REMU
+            return builder->CreateSelect(by_zero, a, builder->CreateURem(a, unsigned_divisor));
+    }
+}
+
+// MISC-MEM
+bool RV32IJIT::rv32i_fence(std::uint32_t, uint32_t& current_pc, RV32I*) {
+    // One hart and no caches to order, so there's nothing to emit
+    current_pc += 4;
+    return true;
+}
+
+// AMO
+bool RV32IJIT::rv32a_amo(std::uint32_t opcode, uint32_t& current_pc, RV32I* core) {
+    std::uint8_t funct3 = (opcode >> 12) & 0x7;
+    std::uint8_t funct5 = opcode >> 27;
+    std::uint8_t rd = (opcode >> 7) & 0x1F;
+
+    if (!core->has_a || funct3 != 0b010) return false;
+
+    switch (funct5) {
+        case 0b00010: case 0b00011: case 0b00001: case 0b00000: case 0b00100:
+        case 0b01100: case 0b01000: case 0b10000: case 0b10100: case 0b11000: case 0b11100:
+            break;
+        default:
+            return false;
+    }
+
+    llvm::Value *address = load_register((opcode >> 15) & 0x1F);
+    llvm::Value *src = load_register((opcode >> 20) & 0x1F);
+
+    // LR.W / SC.W: with a single hart nothing can break the reservation in between, so SC always succeeds
+    if (funct5 == 0b00010) {
+        store_register(rd, emit_read(address, 4));
+        current_pc += 4;
+        return true;
+    }
+
+    if (funct5 == 0b00011) {
+        emit_write(address, src, 4);
+        store_register(rd, builder->getInt32(0));
+        current_pc += 4;
+        return true;
+    }
+
+    llvm::Value *value = emit_read(address, 4);
+    llvm::Value *word = nullptr;
+
+    switch (funct5) {
+        case 0b00001: word = src; break;
+        case 0b00000: word = builder->CreateAdd(value, src); break;
+        case 0b00100: word = builder->CreateXor(value, src); break;
+        case 0b01100: word = builder->CreateAnd(value, src); break;
+        case 0b01000: word = builder->CreateOr(value, src); break;
+        case 0b10000: word = builder->CreateSelect(builder->CreateICmpSLT(value, src), value, src); break;
+        case 0b10100: word = builder->CreateSelect(builder->CreateICmpSGT(value, src), value, src); break;
+        case 0b11000: word = builder->CreateSelect(builder->CreateICmpULT(value, src), value, src); break;
+        case 0b11100: word = builder->CreateSelect(builder->CreateICmpUGT(value, src), value, src); break;
+    }
+
+    emit_write(address, word, 4);
+    store_register(rd, value);
+
+    current_pc += 4;
+    return true;
+}
+
+// Zicsr
+bool RV32IJIT::emit_csr(std::uint32_t opcode, uint32_t& current_pc, bool immediate) {
+    if (!core->has_zicsr) return false;
+
+    std::uint8_t funct3 = (opcode >> 12) & 0x3;
+    std::uint8_t rs1 = (opcode >> 15) & 0x1F;
+    std::uint16_t csr = (opcode >> 20) & 0xFFF;
+
+    llvm::Value *csr_ptr = builder->CreateGEP(builder->getInt32Ty(), state_fields[STATE_CSRS], builder->getInt32(csr));
+    llvm::Value *old_value = builder->CreateLoad(builder->getInt32Ty(), csr_ptr);
+    llvm::Value *operand = immediate ? builder->getInt32(rs1) : load_register(rs1);
+
+    // CSRRS/CSRRC with x0 or a zero immediate only read
+    switch (funct3) {
+        case 0b01:
+            builder->CreateStore(operand, csr_ptr);
+            break;
+        case 0b10:
+            if (rs1 != 0) builder->CreateStore(builder->CreateOr(old_value, operand), csr_ptr);
+            break;
+        case 0b11:
+            if (rs1 != 0) builder->CreateStore(builder->CreateAnd(old_value, builder->CreateNot(operand)), csr_ptr);
+            break;
+    }
+
+    store_register((opcode >> 7) & 0x1F, old_value);
+
+    current_pc += 4;
+    return true;
+}
+
+bool RV32IJIT::rv32i_csrrw(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_csr(opcode, current_pc, false);
+}
+
+bool RV32IJIT::rv32i_csrrs(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_csr(opcode, current_pc, false);
+}
+
+bool RV32IJIT::rv32i_csrrc(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_csr(opcode, current_pc, false);
+}
+
+bool RV32IJIT::rv32i_csrrwi(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_csr(opcode, current_pc, true);
+}
+
+bool RV32IJIT::rv32i_csrrsi(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_csr(opcode, current_pc, true);
+}
+
+bool RV32IJIT::rv32i_csrrci(std::uint32_t opcode, uint32_t& current_pc, RV32I*) {
+    return emit_csr(opcode, current_pc, true);
 }
@@ -1,11 +1,24 @@
 #include <cpu/core/rv32/rv32e.h>
+#include <cpu/core/backends/interpreter.h>
+#include <log/log.hh>
 
 RV32E::RV32E(const std::vector<std::string>& extensions, EmulationType type)
 		: RISCV<32, EMBEDDED>(extensions) {
-	// Constructor implementation for rv32e
+	// The recompiler only targets RV32I so far
+	if (type == EmulationType::JIT || type == EmulationType::Tiered) {
+		Logger::warn("RV32E: No recompiler for this core, falling back to the interpreter");
+	}
+
+	backend = create_interpreter(this, type == EmulationType::Threaded);
+
+	set_step_func([this] { backend->step(); });
+	set_run_func([this](std::uint64_t max_instructions) { return backend->run(max_instructions); });
+}
+
+void RV32E::execute_opcode(std::uint32_t opcode) {
+	backend->execute_opcode(opcode);
 }
 
-void RV32E::executeInstruction(std::uint32_t opcode) {
-	// Implementation of instruction execution for rv32e
-	// Example: decode opcode and execute corresponding instruction
+void RV32E::set_backend(std::unique_ptr<CoreBackend> backend) {
+	this->backend = std::move(backend);
 }
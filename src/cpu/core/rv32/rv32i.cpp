@@ -1,5 +1,5 @@
 #include <cpu/core/rv32/rv32i.h>
-#include <cpu/core/rv32/backends/rv32i_interpreter.h>
+#include <cpu/core/backends/interpreter.h>
 #include <cpu/core/rv32/backends/rv32i_jit.h>
 #include <cpu/registers.h>
 #include <cstring>
@@ -10,12 +10,16 @@ RV32I::RV32I(const std::vector<std::string>& extensions, EmulationType type)
     : RISCV<32>(extensions), backend(std::move(backend)) {
     if (type == EmulationType::JIT) {
         backend = std::make_unique<RV32IJIT>(this);
+    } else if (type == EmulationType::Tiered) {
+        backend = std::make_unique<RV32IJIT>(this, true);
+    } else if (type == EmulationType::Threaded) {
+        backend = create_interpreter(this, true);
     } else {
-        backend = std::make_unique<RV32IInterpreter>(this);
+        backend = create_interpreter(this);
     }
     
     set_step_func([this] { backend->step(); });
-    set_run_func([this] { backend->run(); });
+    set_run_func([this](std::uint64_t max_instructions) { return backend->run(max_instructions); });
 }
 
 void RV32I::execute_opcode(std::uint32_t opcode) {
@@ -1,11 +1,24 @@
 #include <cpu/core/rv64/rv64i.h>
+#include <cpu/core/backends/interpreter.h>
+#include <log/log.hh>
 
 RV64I::RV64I(const std::vector<std::string>& extensions, EmulationType type)
 		: RISCV<64>(extensions) {
-	// Constructor implementation for rv64i
+	// The recompiler only targets RV32I so far
+	if (type == EmulationType::JIT || type == EmulationType::Tiered) {
+		Logger::warn("RV64I: No recompiler for this core, falling back to the interpreter");
+	}
+
+	backend = create_interpreter(this, type == EmulationType::Threaded);
+
+	set_step_func([this] { backend->step(); });
+	set_run_func([this](std::uint64_t max_instructions) { return backend->run(max_instructions); });
+}
+
+void RV64I::execute_opcode(std::uint32_t opcode) {
+	backend->execute_opcode(opcode);
 }
 
-void RV64I::executeInstruction(std::uint32_t opcode) {
-	// Implementation of instruction execution for rv64i
-	// Example: decode opcode and execute corresponding instruction
+void RV64I::set_backend(std::unique_ptr<CoreBackend> backend) {
+	this->backend = std::move(backend);
 }
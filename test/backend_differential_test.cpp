@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+#include <cpu/core/rv32/rv32i.h>
+#include "riscv_test.h"
+#include <cstdlib>
+#include <filesystem>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint32_t CSR = 0x340;
+constexpr std::uint32_t DATA_WORDS = 64;
+
+constexpr std::uint32_t LOOP = RAM_BASE + 20;
+constexpr std::uint32_t AFTER_CALL = RAM_BASE + 232;
+constexpr std::uint32_t FUNCTION = RAM_BASE + 276;
+
+// A checksum loop over RV32IMA and Zicsr: every shift, compare and M op, byte, halfword and word
+// loads and stores into a table, every AMO and LR/SC, CSRs, a call and a return, and branches going both ways
+const std::vector<std::uint32_t> PROGRAM = {
+    rv::lui(rv::s0, TEST_DATA_BASE >> 12), // 0
+    rv::addi(rv::t0, rv::zero, 300),       // 4
+    rv::addi(rv::s2, rv::zero, 0),         // 8
+    rv::lui(rv::t1, 0x8BADF),              // 12
+    rv::addi(rv::t1, rv::t1, 13),          // 16
+    rv::add(rv::s2, rv::s2, rv::t0),       // 20, LOOP
+    rv::xor_(rv::s2, rv::s2, rv::t1),      // 24
+    rv::sll(rv::a0, rv::t1, rv::t0),       // 28
+    rv::add(rv::s2, rv::s2, rv::a0),       // 32
+    rv::srl(rv::a0, rv::s2, rv::t0),       // 36
+    rv::xor_(rv::s2, rv::s2, rv::a0),      // 40
+    rv::sra(rv::a0, rv::t1, rv::t0),       // 44
+    rv::add(rv::s2, rv::s2, rv::a0),       // 48
+    rv::srai(rv::a1, rv::s2, 7),           // 52
+    rv::xor_(rv::s2, rv::s2, rv::a1),      // 56
+    rv::slt(rv::a0, rv::s2, rv::t1),       // 60
+    rv::add(rv::s2, rv::s2, rv::a0),       // 64
+    rv::slti(rv::a0, rv::s2, -5),          // 68
+    rv::add(rv::s2, rv::s2, rv::a0),       // 72
+    rv::xori(rv::s2, rv::s2, 0x5A5),       // 76
+    rv::ori(rv::a1, rv::t0, 0x100),        // 80
+    rv::add(rv::s2, rv::s2, rv::a1),       // 84
+    rv::mul(rv::a1, rv::s2, rv::t1),       // 88
+    rv::mulhu(rv::a2, rv::s2, rv::t1),     // 92
+    rv::div(rv::a3, rv::t1, rv::t0),       // 96
+    rv::xor_(rv::s2, rv::s2, rv::a1),      // 100
+    rv::add(rv::s2, rv::s2, rv::a2),       // 104
+    rv::sub(rv::s2, rv::s2, rv::a3),       // 108
+    rv::mulh(rv::a1, rv::s2, rv::t1),      // 112
+    rv::mulhsu(rv::a2, rv::s2, rv::t1),    // 116
+    rv::divu(rv::a3, rv::s2, rv::t0),      // 120
+    rv::rem(rv::a5, rv::s2, rv::t0),       // 124
+    rv::remu(rv::a6, rv::s2, rv::t0),      // 128
+    rv::xor_(rv::s2, rv::s2, rv::a1),      // 132
+    rv::add(rv::s2, rv::s2, rv::a2),       // 136
+    rv::sub(rv::s2, rv::s2, rv::a3),       // 140
+    rv::add(rv::s2, rv::s2, rv::a5),       // 144
+    rv::xor_(rv::s2, rv::s2, rv::a6),      // 148
+    rv::andi(rv::a4, rv::t0, 0x3F),        // 152
+    rv::slli(rv::a4, rv::a4, 2),           // 156
+    rv::add(rv::a4, rv::a4, rv::s0),       // 160
+    rv::lw(rv::a5, rv::a4, 0),             // 164
+    rv::add(rv::a5, rv::a5, rv::s2),       // 168
+    rv::sw(rv::a5, rv::a4, 0),             // 172
+    rv::sb(rv::s2, rv::a4, 1),             // 176
+    rv::sh(rv::t1, rv::a4, 2),             // 180
+    rv::lbu(rv::a6, rv::a4, 2),            // 184
+    rv::lb(rv::a7, rv::a4, 3),             // 188
+    rv::lh(rv::a0, rv::a4, 0),             // 192
+    rv::lhu(rv::a1, rv::a4, 2),            // 196
+    rv::add(rv::s2, rv::s2, rv::a6),       // 200
+    rv::xor_(rv::s2, rv::s2, rv::a7),      // 204
+    rv::add(rv::s2, rv::s2, rv::a0),       // 208
+    rv::xor_(rv::s2, rv::s2, rv::a1),      // 212
+    rv::amoadd_w(rv::a6, rv::s2, rv::s0),  // 216
+    rv::csrrw(rv::a7, CSR, rv::s2),        // 220
+    rv::add(rv::s2, rv::s2, rv::a7),       // 224
+    rv::jal(rv::ra, 48),                   // 228, to FUNCTION
+    rv::sltu(rv::a0, rv::s2, rv::t1),      // 232, AFTER_CALL
+    rv::bne(rv::a0, rv::zero, 8),          // 236
+    rv::addi(rv::s2, rv::s2, 7),           // 240
+    rv::srli(rv::a1, rv::s2, 3),           // 244
+    rv::xor_(rv::s2, rv::s2, rv::a1),      // 248
+    rv::sltiu(rv::a2, rv::t0, 100),        // 252
+    rv::beq(rv::a2, rv::zero, 8),          // 256
+    rv::addi(rv::s2, rv::s2, 1),           // 260
+    rv::addi(rv::t0, rv::t0, -1),          // 264
+    rv::bne(rv::t0, rv::zero, -248),       // 268, to LOOP
+    rv::EBREAK,                            // 272
+    rv::amoor_w(rv::a3, rv::t0, rv::s0),   // 276, FUNCTION
+    rv::addi(rv::t2, rv::s0, 8),           // 280
+    rv::amoswap_w(rv::a5, rv::s2, rv::t2), // 284
+    rv::amoxor_w(rv::a6, rv::t1, rv::t2),  // 288
+    rv::amoand_w(rv::a7, rv::s2, rv::s0),  // 292
+    rv::add(rv::s2, rv::s2, rv::a5),       // 296
+    rv::xor_(rv::s2, rv::s2, rv::a6),      // 300
+    rv::add(rv::s2, rv::s2, rv::a7),       // 304
+    rv::amomin_w(rv::a5, rv::s2, rv::t2),  // 308
+    rv::amomax_w(rv::a6, rv::t1, rv::s0),  // 312
+    rv::amominu_w(rv::a7, rv::t0, rv::t2), // 316
+    rv::add(rv::s2, rv::s2, rv::a5),       // 320
+    rv::xor_(rv::s2, rv::s2, rv::a6),      // 324
+    rv::add(rv::s2, rv::s2, rv::a7),       // 328
+    rv::amomaxu_w(rv::a5, rv::s2, rv::s0), // 332
+    rv::lr_w(rv::a6, rv::t2),              // 336
+    rv::add(rv::a6, rv::a6, rv::a5),       // 340
+    rv::sc_w(rv::a7, rv::a6, rv::t2),      // 344
+    rv::add(rv::s2, rv::s2, rv::a6),       // 348
+    rv::add(rv::s2, rv::s2, rv::a7),       // 352
+    rv::csrrs(rv::a4, CSR, rv::t0),        // 356
+    rv::add(rv::s2, rv::s2, rv::a4),       // 360
+    rv::jalr(rv::zero, rv::ra, 0),         // 364
+};
+
+// Back to the top with every register, the CSR and the table cleared
+void reset_program(RV32I& core) {
+    core.reset();
+    core.csrs[CSR] = 0;
+    for (std::uint32_t word = 0; word < DATA_WORDS; word++) {
+        core.bus.write32(TEST_DATA_BASE + word * 4, 0);
+    }
+}
+
+// Everything the program writes, the CSR and the table included
+State capture_program(RV32I& core) {
+    return capture(core, {CSR}, TEST_DATA_BASE, DATA_WORDS);
+}
+
+State run_program(RV32I& core) {
+    reset_program(core);
+    EXPECT_EQ(core.get_backend()->run(100000000), ExitReason::Breakpoint);
+    EXPECT_FALSE(Risky::is_aborted());
+    return capture_program(core);
+}
+
+const State& reference() {
+    static const State state = [] {
+        auto core = make_core(EmulationType::Interpreter, PROGRAM);
+        return run_program(*core);
+    }();
+    return state;
+}
+
+bool loop_compiled(const std::vector<CompiledBlock>& blocks) {
+    return find_block(blocks, LOOP) && find_block(blocks, AFTER_CALL) && find_block(blocks, FUNCTION);
+}
+
+bool has_tier_2(const std::vector<CompiledBlock>& blocks) {
+    for (const auto& block : blocks) {
+        if (block.tier == 2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Keeps running the program on a JIT core until ready() holds, every run has to match the interpreter
+template <typename Ready>
+void check_jit(RV32I& core, Ready ready) {
+    auto* jit = dynamic_cast<JITBackend*>(core.get_backend());
+    ASSERT_NE(jit, nullptr);
+
+    std::size_t runs = 0;
+    bool compiled = run_until_compiled(*jit, [&] {
+        runs++;
+        ASSERT_EQ(run_program(core), reference()) << "run " << runs;
+    }, ready);
+    ASSERT_TRUE(compiled);
+
+    // Once more, now that everything asked for is native code from the start
+    EXPECT_EQ(run_program(core), reference());
+}
+
+// Runs the program a budget at a time next to the interpreter, run(n) has to stop on the very same instruction
+void check_budget(RV32I& core, std::uint64_t budget) {
+    auto interpreter = make_core(EmulationType::Interpreter, PROGRAM);
+    reset_program(*interpreter);
+    reset_program(core);
+
+    for (std::size_t runs = 1; ; runs++) {
+        ExitReason expected = interpreter->get_backend()->run(budget);
+        ASSERT_EQ(core.get_backend()->run(budget), expected) << "run " << runs;
+        ASSERT_EQ(capture_program(core), capture_program(*interpreter)) << "run " << runs;
+
+        if (expected != ExitReason::BudgetExhausted) {
+            break;
+        }
+    }
+
+    EXPECT_FALSE(Risky::is_aborted());
+}
+
+class BackendDifferential : public ::testing::Test {
+protected:
+    void SetUp() override {
+        setenv("RISKY_JIT_CACHE", "off", 1);
+    }
+};
+
+}
+
+TEST_F(BackendDifferential, ThreadedInterpreter) {
+    auto core = make_core(EmulationType::Threaded, PROGRAM);
+    EXPECT_EQ(run_program(*core), reference());
+}
+
+TEST_F(BackendDifferential, JITTier1) {
+    auto core = make_core(EmulationType::JIT, PROGRAM);
+    dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(1, 0);
+
+    check_jit(*core, loop_compiled);
+
+    for (const auto& block : dynamic_cast<JITBackend*>(core->get_backend())->get_compiled_blocks()) {
+        EXPECT_EQ(block.tier, 1) << std::hex << block.start_pc;
+    }
+}
+
+// Zero is clamped to one worker, the blocks still get compiled
+TEST_F(BackendDifferential, JITSingleCompileWorker) {
+    auto core = make_core(EmulationType::JIT, PROGRAM);
+    auto* jit = dynamic_cast<JITBackend*>(core->get_backend());
+    jit->set_tier_thresholds(1, 0);
+    jit->set_compile_workers(0);
+
+    check_jit(*core, loop_compiled);
+}
+
+// Budgets that end inside blocks, between chained ones and partway round a loop
+TEST_F(BackendDifferential, JITTier1StopsOnTheBudget) {
+    auto core = make_core(EmulationType::JIT, PROGRAM);
+    dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(1, 0);
+    check_jit(*core, loop_compiled);
+
+    for (std::uint64_t budget : {1, 7, 97, 1000}) {
+        SCOPED_TRACE("budget " + std::to_string(budget));
+        check_budget(*core, budget);
+    }
+}
+
+TEST_F(BackendDifferential, JITTier2) {
+    auto core = make_core(EmulationType::JIT, PROGRAM);
+    dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(1, 16);
+
+    check_jit(*core, has_tier_2);
+}
+
+TEST_F(BackendDifferential, JITTier2StopsOnTheBudget) {
+    auto core = make_core(EmulationType::JIT, PROGRAM);
+    dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(1, 16);
+    check_jit(*core, has_tier_2);
+
+    for (std::uint64_t budget : {1, 7, 97, 1000}) {
+        SCOPED_TRACE("budget " + std::to_string(budget));
+        check_budget(*core, budget);
+    }
+}
+
+TEST_F(BackendDifferential, TieredInterpreterToTier2) {
+    auto core = make_core(EmulationType::Tiered, PROGRAM);
+    dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(4, 64);
+
+    check_jit(*core, [](const auto& blocks) { return loop_compiled(blocks) && has_tier_2(blocks); });
+}
+
+TEST_F(BackendDifferential, JITObjectCache) {
+    std::filesystem::path cache_home = std::filesystem::temp_directory_path() / ("risky-test-cache-" + std::to_string(getpid()));
+    std::filesystem::remove_all(cache_home);
+    unsetenv("RISKY_JIT_CACHE");
+    setenv("XDG_CACHE_HOME", cache_home.c_str(), 1);
+
+    // The first core fills the cache, the second one has to load the same blocks back from it
+    {
+        auto core = make_core(EmulationType::JIT, PROGRAM);
+        dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(1, 0);
+        check_jit(*core, loop_compiled);
+    }
+
+    auto core = make_core(EmulationType::JIT, PROGRAM);
+    dynamic_cast<JITBackend*>(core->get_backend())->set_tier_thresholds(1, 0);
+    check_jit(*core, [](const auto& blocks) {
+        return loop_compiled(blocks) && find_block(blocks, LOOP)->from_cache && find_block(blocks, FUNCTION)->from_cache;
+    });
+
+    std::filesystem::remove_all(cache_home);
+}
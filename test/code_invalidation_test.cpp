@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <cpu/core/rv32/rv32i.h>
+#include "riscv_test.h"
+#include <cstdlib>
+
+namespace {
+
+constexpr std::uint32_t PATCHED = rv::addi(rv::a0, rv::a0, 100);
+
+// a0 += 1 from RAM_BASE, and a store of s1 to s0 from RAM_BASE + 8 that patches it
+const std::vector<std::uint32_t> PROGRAM = {
+    rv::addi(rv::a0, rv::a0, 1),
+    rv::EBREAK,
+    rv::sw(rv::s1, rv::s0, 0),
+    rv::EBREAK,
+};
+
+// Loops three times over an increment it patches, fence.i makes the new one count from the second round
+const std::vector<std::uint32_t> FENCED_LOOP = {
+    rv::addi(rv::a0, rv::a0, 1),
+    rv::addi(rv::t0, rv::t0, -1),
+    rv::sw(rv::s1, rv::s0, 0),
+    rv::FENCE_I,
+    rv::bne(rv::t0, rv::zero, -16),
+    rv::EBREAK,
+};
+
+class CodeInvalidation : public ::testing::TestWithParam<EmulationType> {
+protected:
+    void SetUp() override {
+        setenv("RISKY_JIT_CACHE", "off", 1);
+        core = make_core(GetParam());
+
+        if (auto* jit = dynamic_cast<JITBackend*>(core->get_backend())) {
+            jit->set_tier_thresholds(1, 0);
+        }
+    }
+
+    ExitReason run_from(std::uint32_t pc) {
+        core->pc = pc;
+        return core->get_backend()->run(1000);
+    }
+
+    // Runs the increment until it's predecoded, or compiled when there's a JIT
+    void warm_up() {
+        auto run = [this] {
+            core->registers[rv::a0] = 0;
+            ASSERT_EQ(run_from(RAM_BASE), ExitReason::Breakpoint);
+            ASSERT_EQ(core->registers[rv::a0], 1u);
+        };
+
+        if (auto* jit = dynamic_cast<JITBackend*>(core->get_backend())) {
+            ASSERT_TRUE(run_until_compiled(*jit, run, [](const auto& blocks) { return find_block(blocks, RAM_BASE); }));
+        } else {
+            run();
+        }
+    }
+
+    std::unique_ptr<RV32I> core;
+};
+
+}
+
+TEST_P(CodeInvalidation, GuestStoreReplacesCachedCode) {
+    load_program(*core, PROGRAM);
+    warm_up();
+
+    core->registers[rv::s0] = RAM_BASE;
+    core->registers[rv::s1] = PATCHED;
+    ASSERT_EQ(run_from(RAM_BASE + 8), ExitReason::Breakpoint);
+
+    core->registers[rv::a0] = 0;
+    EXPECT_EQ(run_from(RAM_BASE), ExitReason::Breakpoint);
+    EXPECT_EQ(core->registers[rv::a0], 100u);
+    EXPECT_FALSE(Risky::is_aborted());
+}
+
+TEST_P(CodeInvalidation, BusWriteReplacesCachedCode) {
+    load_program(*core, PROGRAM);
+    warm_up();
+
+    core->bus.write32(RAM_BASE, PATCHED);
+
+    core->registers[rv::a0] = 0;
+    EXPECT_EQ(run_from(RAM_BASE), ExitReason::Breakpoint);
+    EXPECT_EQ(core->registers[rv::a0], 100u);
+    EXPECT_FALSE(Risky::is_aborted());
+}
+
+TEST_P(CodeInvalidation, FenceIInsideTheRunningLoop) {
+    load_program(*core, FENCED_LOOP);
+
+    // Again and again, so the JIT gets to run the loop from compiled code
+    for (int round = 0; round < 50; round++) {
+        load_program(*core, {FENCED_LOOP[0]});
+        core->registers[rv::a0] = 0;
+        core->registers[rv::t0] = 3;
+        core->registers[rv::s0] = RAM_BASE;
+        core->registers[rv::s1] = PATCHED;
+
+        ASSERT_EQ(run_from(RAM_BASE), ExitReason::Breakpoint);
+        ASSERT_EQ(core->registers[rv::a0], 201u) << "round " << round;
+    }
+
+    EXPECT_FALSE(Risky::is_aborted());
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, CodeInvalidation,
+                         ::testing::Values(EmulationType::Interpreter, EmulationType::Threaded,
+                                           EmulationType::JIT, EmulationType::Tiered),
+                         [](const ::testing::TestParamInfo<EmulationType>& info) {
+                             switch (info.param) {
+                                 case EmulationType::Interpreter: return "Interpreter";
+                                 case EmulationType::Threaded: return "Threaded";
+                                 case EmulationType::JIT: return "JIT";
+                                 case EmulationType::Tiered: return "Tiered";
+                             }
+                             return "Unknown";
+                         });
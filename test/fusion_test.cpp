@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <cpu/core/rv32/rv32i.h>
+#include "riscv_test.h"
+
+namespace {
+
+// Every pair try_fuse() knows, with taken and fall-through branches and halves sharing rd
+const std::vector<std::uint32_t> PROGRAM = {
+    rv::lui(rv::a0, 0x12345),            // 0
+    rv::addi(rv::a0, rv::a0, -2048),     // 4
+    rv::auipc(rv::a1, 0),                // 8
+    rv::lw(rv::a2, rv::a1, 88),          // 12, loads DATA
+    rv::sltu(rv::a3, rv::a2, rv::a0),    // 16
+    rv::bne(rv::a3, rv::zero, 8),        // 20, falls through
+    rv::sltiu(rv::a4, rv::a0, -1),       // 24
+    rv::bne(rv::a4, rv::zero, 8),        // 28, taken
+    rv::addi(rv::s2, rv::zero, 1),       // 32
+    rv::sltu(rv::a5, rv::a0, rv::a2),    // 36
+    rv::beq(rv::a5, rv::zero, 8),        // 40, falls through
+    rv::sltiu(rv::a6, rv::a0, 1),        // 44
+    rv::beq(rv::a6, rv::zero, 8),        // 48, taken
+    rv::addi(rv::s3, rv::zero, 1),       // 52
+    rv::auipc(rv::t1, 0),                // 56
+    rv::jalr(rv::ra, rv::t1, 12),        // 60, to 68
+    rv::addi(rv::s4, rv::zero, 1),       // 64
+    rv::auipc(rv::t2, 0),                // 68
+    rv::jalr(rv::t2, rv::t2, 12),        // 72, to 80
+    rv::addi(rv::s5, rv::zero, 1),       // 76
+    rv::auipc(rv::a7, 0),                // 80
+    rv::lw(rv::a7, rv::a7, 16),          // 84, loads DATA
+    rv::EBREAK,                          // 88
+    rv::addi(rv::zero, rv::zero, 0),     // 92
+    0xDEADBEEF,                          // 96, DATA
+};
+
+// The state after each instruction, stepped one at a time, which never fuses
+std::vector<State> unfused_states() {
+    auto core = make_core(EmulationType::Interpreter, PROGRAM);
+    std::vector<State> states = {capture(*core)};
+
+    while (states.back().pc != RAM_BASE + 92) {
+        core->get_backend()->step();
+        states.push_back(capture(*core));
+    }
+
+    return states;
+}
+
+class Fusion : public ::testing::TestWithParam<EmulationType> {};
+
+}
+
+TEST_P(Fusion, EveryPairIsFused) {
+    auto core = make_core(GetParam(), PROGRAM);
+    ASSERT_EQ(core->get_backend()->run(1000), ExitReason::Breakpoint);
+
+    auto* interpreter = dynamic_cast<InterpreterBackend*>(core->get_backend());
+    ASSERT_NE(interpreter, nullptr);
+
+    for (const auto& [name, count] : interpreter->get_fusion_stats()) {
+        EXPECT_GT(count, 0u) << name;
+    }
+}
+
+TEST_P(Fusion, SameStateAsUnfused) {
+    std::vector<State> expected = unfused_states();
+    ASSERT_FALSE(Risky::is_aborted());
+
+    auto core = make_core(GetParam(), PROGRAM);
+    EXPECT_EQ(core->get_backend()->run(1000), ExitReason::Breakpoint);
+    EXPECT_EQ(capture(*core), expected.back());
+    EXPECT_FALSE(Risky::is_aborted());
+}
+
+TEST_P(Fusion, BudgetEndingInsideAPair) {
+    std::vector<State> expected = unfused_states();
+    std::size_t instructions = expected.size() - 1;
+
+    // A pair the budget ends in must retire only its first half, and the next run picks up from the second
+    for (std::size_t budget = 1; budget < instructions; budget++) {
+        SCOPED_TRACE("budget " + std::to_string(budget));
+        auto core = make_core(GetParam(), PROGRAM);
+
+        ASSERT_EQ(core->get_backend()->run(budget), ExitReason::BudgetExhausted);
+        EXPECT_EQ(capture(*core), expected[budget]);
+
+        ASSERT_EQ(core->get_backend()->run(instructions - budget), ExitReason::Breakpoint);
+        EXPECT_EQ(capture(*core), expected.back());
+    }
+}
+
+TEST_P(Fusion, SingleInstructionBudgets) {
+    std::vector<State> expected = unfused_states();
+    auto core = make_core(GetParam(), PROGRAM);
+
+    for (std::size_t retired = 1; retired < expected.size(); retired++) {
+        ExitReason reason = core->get_backend()->run(1);
+        EXPECT_EQ(reason, retired + 1 == expected.size() ? ExitReason::Breakpoint : ExitReason::BudgetExhausted);
+        ASSERT_EQ(capture(*core), expected[retired]) << "after " << retired << " instructions";
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Interpreters, Fusion,
+                         ::testing::Values(EmulationType::Interpreter, EmulationType::Threaded),
+                         [](const ::testing::TestParamInfo<EmulationType>& info) {
+                             return info.param == EmulationType::Threaded ? "Threaded" : "Switch";
+                         });
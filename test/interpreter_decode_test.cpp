@@ -0,0 +1,362 @@
+#include <gtest/gtest.h>
+#include <cpu/core/rv32/rv32i.h>
+#include <cpu/core/rv64/rv64i.h>
+#include "riscv_test.h"
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+struct Profile {
+    bool rv64;
+    bool m;
+    bool a;
+    bool zicsr;
+    bool zifencei;
+};
+
+// Whether the interpreter's tables have a handler for the instruction
+bool decodes(std::uint32_t instruction, const Profile& profile) {
+    std::uint32_t funct3 = (instruction >> 12) & 0x7;
+    std::uint32_t funct7 = instruction >> 25;
+
+    switch (instruction & 0x7F) {
+        case LUI:
+        case AUIPC:
+        case JAL:
+            return true;
+
+        // funct3 isn't checked for JALR, every row takes the funct3 000 handler
+        case JALR:
+            return true;
+
+        case LOAD:
+            return funct3 == 0b000 || funct3 == 0b001 || funct3 == 0b010 || funct3 == 0b100 || funct3 == 0b101 ||
+                   (profile.rv64 && (funct3 == 0b011 || funct3 == 0b110));
+
+        case STORE:
+            return funct3 == 0b000 || funct3 == 0b001 || funct3 == 0b010 || (profile.rv64 && funct3 == 0b011);
+
+        case OPIMM:
+            return true;
+
+        case OPIMM32:
+            return profile.rv64 && (funct3 == 0b000 || funct3 == 0b001 || funct3 == 0b101);
+
+        case BRANCH:
+            return funct3 != 0b010 && funct3 != 0b011;
+
+        case MISCMEM:
+            return funct3 == 0b000 || (funct3 == 0b001 && profile.zifencei);
+
+        case SYSTEM:
+            if (funct3 == 0b000) {
+                std::uint32_t imm = instruction >> 20;
+                return imm == 0x000 || imm == 0x001 || imm == 0x105;
+            }
+            return funct3 != 0b100 && profile.zicsr;
+
+        case OP:
+            if (funct7 == 0x00) {
+                return true;
+            }
+            if (funct7 == 0x20) {
+                return funct3 == 0b000 || funct3 == 0b101;
+            }
+            if (funct7 == 0x01) {
+                return profile.m;
+            }
+            return false;
+
+        case OP32:
+            return profile.rv64 && funct3 == 0b000 && (funct7 == 0x00 || funct7 == 0x20);
+
+        case AMO:
+            switch (funct7 >> 2) {
+                case 0b00000: case 0b00001: case 0b00010: case 0b00011: case 0b00100: case 0b01000:
+                case 0b01100: case 0b10000: case 0b10100: case 0b11000: case 0b11100:
+                    return profile.a && funct3 == 0b010;
+                default:
+                    return false;
+            }
+
+        default:
+            return false;
+    }
+}
+
+// Every row of the tables: each funct3 of each major opcode, each funct7 of OP and OP-32,
+// each funct5 of AMO and the funct12 values SYSTEM's funct3 000 row tells apart
+std::vector<std::uint32_t> decode_table_rows() {
+    std::vector<std::uint32_t> rows;
+
+    for (std::uint32_t opcode = 0; opcode < 0x80; opcode++) {
+        for (std::uint32_t funct3 = 0; funct3 < 8; funct3++) {
+            if (opcode == OP || opcode == OP32) {
+                for (std::uint32_t funct7 = 0; funct7 < 0x80; funct7++) {
+                    rows.push_back(rv::r_type(funct7, rv::a2, rv::a1, funct3, rv::a0, opcode));
+                }
+            } else if (opcode == AMO) {
+                for (std::uint32_t funct5 = 0; funct5 < 0x20; funct5++) {
+                    rows.push_back(rv::r_type(funct5 << 2, rv::a2, rv::a1, funct3, rv::a0, opcode));
+                }
+            } else if (opcode == SYSTEM && funct3 == 0b000) {
+                for (std::uint32_t funct12 : {0x000u, 0x001u, 0x002u, 0x102u, 0x105u, 0x302u, 0x7FFu}) {
+                    rows.push_back((funct12 << 20) | SYSTEM);
+                }
+            } else {
+                rows.push_back(rv::r_type(0, rv::a2, rv::a1, funct3, rv::a0, opcode));
+            }
+        }
+    }
+
+    return rows;
+}
+
+std::vector<std::string> profile_extensions(const Profile& profile) {
+    std::vector<std::string> extensions;
+    if (profile.m) extensions.push_back("M");
+    if (profile.a) extensions.push_back("A");
+    if (profile.zicsr) extensions.push_back("Zicsr");
+    if (profile.zifencei) extensions.push_back("Zifencei");
+    return extensions;
+}
+
+// Runs each row as the only instruction of a batch, through the predecoded pages and
+// (threaded) the label table, and checks it aborts exactly when the tables say it's illegal
+template <typename CoreType>
+void check_decode_table(const Profile& profile, EmulationType type) {
+    CoreType core(profile_extensions(profile), type);
+
+    for (std::uint32_t instruction : decode_table_rows()) {
+        core.reset();
+        core.registers[rv::a1] = TEST_DATA_BASE;
+        core.registers[rv::a2] = 5;
+        load_program(core, {instruction, rv::EBREAK});
+
+        ExitReason reason = core.get_backend()->run(1);
+        bool aborted = Risky::is_aborted();
+        Risky::reset_aborted();
+
+        bool legal = decodes(instruction, profile);
+        EXPECT_EQ(aborted, !legal) << std::hex << "instruction 0x" << instruction;
+        EXPECT_EQ(reason == ExitReason::Error, !legal) << std::hex << "instruction 0x" << instruction;
+    }
+}
+
+constexpr Profile RV32_ALL = {false, true, true, true, true};
+constexpr Profile RV32_BASE = {false, false, false, false, false};
+constexpr Profile RV32_NO_M = {false, false, true, true, true};
+constexpr Profile RV64_ALL = {true, true, true, true, true};
+
+}
+
+TEST(InterpreterDecode, EveryRowRV32) {
+    check_decode_table<RV32I>(RV32_ALL, EmulationType::Interpreter);
+    check_decode_table<RV32I>(RV32_ALL, EmulationType::Threaded);
+}
+
+TEST(InterpreterDecode, EveryRowRV32WithoutExtensions) {
+    check_decode_table<RV32I>(RV32_BASE, EmulationType::Interpreter);
+    check_decode_table<RV32I>(RV32_BASE, EmulationType::Threaded);
+}
+
+TEST(InterpreterDecode, EveryRowRV32WithoutM) {
+    check_decode_table<RV32I>(RV32_NO_M, EmulationType::Interpreter);
+    check_decode_table<RV32I>(RV32_NO_M, EmulationType::Threaded);
+}
+
+TEST(InterpreterDecode, EveryRowRV64) {
+    check_decode_table<RV64I>(RV64_ALL, EmulationType::Interpreter);
+    check_decode_table<RV64I>(RV64_ALL, EmulationType::Threaded);
+}
+
+namespace {
+
+constexpr std::uint32_t A2 = 0xFFFFFFF9;
+constexpr std::uint32_t A3 = 0x8BADF00D;
+constexpr std::uint32_t DATA = 0xDEADBEEF;
+constexpr std::uint32_t CSR = 0x340;
+constexpr std::uint32_t CSR_VALUE = 0x55;
+
+// What one instruction does, starting from a1 = TEST_DATA_BASE, a2 = A2, a3 = A3,
+// DATA at TEST_DATA_BASE and CSR_VALUE in CSR
+struct Case {
+    const char* name;
+    std::uint32_t instruction;
+    std::uint32_t a0;
+    std::optional<std::uint32_t> pc = std::nullopt;
+    std::optional<std::uint32_t> memory = std::nullopt;
+    std::optional<std::uint32_t> csr = std::nullopt;
+    ExitReason exit = ExitReason::BudgetExhausted;
+};
+
+const std::vector<Case>& cases() {
+    static const std::vector<Case> cases = {
+        {"lui", rv::lui(rv::a0, 0x12345), 0x12345000},
+        {"auipc", rv::auipc(rv::a0, 0x1), RAM_BASE + 0x1000},
+        {"jal", rv::jal(rv::a0, 16), RAM_BASE + 4, RAM_BASE + 16},
+        {"jalr", rv::jalr(rv::a0, rv::a1, 5), RAM_BASE + 4, TEST_DATA_BASE + 4},
+        {"beq", rv::beq(rv::a2, rv::a3, 16), 0, RAM_BASE + 4},
+        {"bne", rv::bne(rv::a2, rv::a3, 16), 0, RAM_BASE + 16},
+        {"blt", rv::blt(rv::a2, rv::a3, 16), 0, RAM_BASE + 4},
+        {"bge", rv::bge(rv::a2, rv::a3, 16), 0, RAM_BASE + 16},
+        {"bltu", rv::bltu(rv::a2, rv::a3, -16), 0, RAM_BASE + 4},
+        {"bgeu", rv::bgeu(rv::a2, rv::a3, -16), 0, RAM_BASE - 16},
+        {"lb", rv::lb(rv::a0, rv::a1, 3), 0xFFFFFFDE},
+        {"lw", rv::lw(rv::a0, rv::a1, 0), DATA},
+        {"lbu", rv::lbu(rv::a0, rv::a1, 3), 0xDE},
+        {"lh", rv::lh(rv::a0, rv::a1, 2), 0xFFFFDEAD},
+        {"lhu", rv::lhu(rv::a0, rv::a1, 2), 0xDEAD},
+        {"sb", rv::sb(rv::a3, rv::a1, 1), 0, std::nullopt, 0xDEAD0DEF},
+        {"sh", rv::sh(rv::a3, rv::a1, 2), 0, std::nullopt, 0xF00DBEEF},
+        {"sw", rv::sw(rv::a3, rv::a1, 0), 0, std::nullopt, A3},
+        {"addi", rv::addi(rv::a0, rv::a2, 100), 93},
+        {"slli", rv::slli(rv::a0, rv::a3, 4), A3 << 4},
+        {"sltiu", rv::sltiu(rv::a0, rv::a3, -1), 1},
+        {"srli", rv::srli(rv::a0, rv::a3, 4), A3 >> 4},
+        {"srai", rv::srai(rv::a0, rv::a3, 4), static_cast<std::uint32_t>(static_cast<std::int32_t>(A3) >> 4)},
+        {"andi", rv::andi(rv::a0, rv::a3, 0xFF), 0x0D},
+        {"slti", rv::slti(rv::a0, rv::a2, -6), 1},
+        {"xori", rv::xori(rv::a0, rv::a3, -1), ~A3},
+        {"ori", rv::ori(rv::a0, rv::a3, 0x7F0), A3 | 0x7F0},
+        {"add", rv::add(rv::a0, rv::a2, rv::a3), A2 + A3},
+        {"sub", rv::sub(rv::a0, rv::a2, rv::a3), A2 - A3},
+        {"sll", rv::sll(rv::a0, rv::a3, rv::a2), A3 << (A2 & 31)},
+        {"sltu", rv::sltu(rv::a0, rv::a3, rv::a2), 1},
+        {"xor", rv::xor_(rv::a0, rv::a2, rv::a3), A2 ^ A3},
+        {"or", rv::or_(rv::a0, rv::a2, rv::a3), A2 | A3},
+        {"and", rv::and_(rv::a0, rv::a2, rv::a3), A2 & A3},
+        {"slt", rv::slt(rv::a0, rv::a3, rv::a2), 1},
+        {"srl", rv::srl(rv::a0, rv::a3, rv::a2), A3 >> (A2 & 31)},
+        {"sra", rv::sra(rv::a0, rv::a3, rv::a2), static_cast<std::uint32_t>(static_cast<std::int32_t>(A3) >> (A2 & 31))},
+        {"mul", rv::mul(rv::a0, rv::a2, rv::a3), A2 * A3},
+        {"mulhu", rv::mulhu(rv::a0, rv::a2, rv::a3),
+         static_cast<std::uint32_t>((static_cast<std::uint64_t>(A2) * A3) >> 32)},
+        {"div", rv::div(rv::a0, rv::a3, rv::a2),
+         static_cast<std::uint32_t>(static_cast<std::int32_t>(A3) / static_cast<std::int32_t>(A2))},
+        {"div by zero", rv::div(rv::a0, rv::a3, rv::zero), 0xFFFFFFFF},
+        {"mulh", rv::mulh(rv::a0, rv::a2, rv::a3),
+         static_cast<std::uint32_t>((static_cast<std::int64_t>(static_cast<std::int32_t>(A2)) * static_cast<std::int32_t>(A3)) >> 32)},
+        {"mulhsu", rv::mulhsu(rv::a0, rv::a2, rv::a3),
+         static_cast<std::uint32_t>((static_cast<std::int64_t>(static_cast<std::int32_t>(A2)) * static_cast<std::int64_t>(A3)) >> 32)},
+        {"divu", rv::divu(rv::a0, rv::a2, rv::a3), A2 / A3},
+        {"divu by zero", rv::divu(rv::a0, rv::a3, rv::zero), 0xFFFFFFFF},
+        {"rem", rv::rem(rv::a0, rv::a3, rv::a2),
+         static_cast<std::uint32_t>(static_cast<std::int32_t>(A3) % static_cast<std::int32_t>(A2))},
+        {"rem by zero", rv::rem(rv::a0, rv::a3, rv::zero), A3},
+        {"remu", rv::remu(rv::a0, rv::a2, rv::a3), A2 % A3},
+        {"remu by zero", rv::remu(rv::a0, rv::a3, rv::zero), A3},
+        {"csrrw", rv::csrrw(rv::a0, CSR, rv::a3), CSR_VALUE, std::nullopt, std::nullopt, A3},
+        {"csrrs", rv::csrrs(rv::a0, CSR, rv::a3), CSR_VALUE, std::nullopt, std::nullopt, CSR_VALUE | A3},
+        {"csrrc", rv::csrrc(rv::a0, CSR, rv::a2), CSR_VALUE, std::nullopt, std::nullopt, CSR_VALUE & ~A2},
+        {"csrrwi", rv::csrrwi(rv::a0, CSR, 13), CSR_VALUE, std::nullopt, std::nullopt, 13},
+        {"csrrsi", rv::csrrsi(rv::a0, CSR, 0x0A), CSR_VALUE, std::nullopt, std::nullopt, CSR_VALUE | 0x0A},
+        {"csrrci", rv::csrrci(rv::a0, CSR, 0x05), CSR_VALUE, std::nullopt, std::nullopt, CSR_VALUE & ~0x05u},
+        {"csrrs from x0", rv::csrrs(rv::a0, CSR, rv::zero), CSR_VALUE},
+        {"csrrsi zero", rv::csrrsi(rv::a0, CSR, 0), CSR_VALUE},
+        {"csrrci zero", rv::csrrci(rv::a0, CSR, 0), CSR_VALUE},
+        {"amoadd.w", rv::amoadd_w(rv::a0, rv::a3, rv::a1), DATA, std::nullopt, DATA + A3},
+        {"amoor.w", rv::amoor_w(rv::a0, rv::a3, rv::a1), DATA, std::nullopt, DATA | A3},
+        {"amoswap.w", rv::amoswap_w(rv::a0, rv::a3, rv::a1), DATA, std::nullopt, A3},
+        {"amoxor.w", rv::amoxor_w(rv::a0, rv::a3, rv::a1), DATA, std::nullopt, DATA ^ A3},
+        {"amoand.w", rv::amoand_w(rv::a0, rv::a3, rv::a1), DATA, std::nullopt, DATA & A3},
+        {"amomin.w", rv::amomin_w(rv::a0, rv::a3, rv::a1), DATA, std::nullopt, A3},
+        {"amomax.w", rv::amomax_w(rv::a0, rv::zero, rv::a1), DATA, std::nullopt, 0},
+        {"amominu.w", rv::amominu_w(rv::a0, rv::zero, rv::a1), DATA, std::nullopt, 0},
+        {"amomaxu.w", rv::amomaxu_w(rv::a0, rv::a2, rv::a1), DATA, std::nullopt, A2},
+        {"lr.w", rv::lr_w(rv::a0, rv::a1), DATA},
+        {"sc.w", rv::sc_w(rv::a0, rv::a3, rv::a1), 0, std::nullopt, A3},
+        {"fence", rv::FENCE, 0},
+        {"fence.i", rv::FENCE_I, 0},
+        {"ecall", rv::ECALL, 0, std::nullopt, std::nullopt, std::nullopt, ExitReason::Trap},
+        {"ebreak", rv::EBREAK, 0, std::nullopt, std::nullopt, std::nullopt, ExitReason::Breakpoint},
+        {"wfi", rv::WFI, 0, std::nullopt, std::nullopt, std::nullopt, ExitReason::Halt},
+    };
+
+    return cases;
+}
+
+void check_cases(EmulationType type) {
+    RV32I core({"M", "A", "Zicsr", "Zifencei"}, type);
+
+    for (const Case& test : cases()) {
+        SCOPED_TRACE(test.name);
+
+        core.reset();
+        core.registers[rv::a1] = TEST_DATA_BASE;
+        core.registers[rv::a2] = A2;
+        core.registers[rv::a3] = A3;
+        core.csrs[CSR] = CSR_VALUE;
+        core.bus.write32(TEST_DATA_BASE, DATA);
+        load_program(core, {test.instruction, rv::EBREAK});
+
+        ExitReason reason = core.get_backend()->run(1);
+        ASSERT_FALSE(Risky::is_aborted());
+
+        EXPECT_EQ(reason, test.exit);
+        EXPECT_EQ(core.registers[rv::a0], test.a0);
+        EXPECT_EQ(core.pc, test.pc.value_or(RAM_BASE + 4));
+        EXPECT_EQ(core.bus.read32(TEST_DATA_BASE), test.memory.value_or(DATA));
+        EXPECT_EQ(core.csrs[CSR], test.csr.value_or(CSR_VALUE));
+    }
+}
+
+}
+
+TEST(InterpreterDecode, ImplementedRowsExecute) {
+    check_cases(EmulationType::Interpreter);
+}
+
+TEST(InterpreterDecode, ImplementedRowsExecuteThreaded) {
+    check_cases(EmulationType::Threaded);
+}
+
+TEST(InterpreterDecode, WritesToX0AreDiscarded) {
+    RV32I core({"M", "A", "Zicsr", "Zifencei"}, EmulationType::Interpreter);
+    load_program(core, {rv::addi(rv::zero, rv::zero, 5), rv::lui(rv::zero, 0x12345), rv::EBREAK});
+
+    EXPECT_EQ(core.get_backend()->run(3), ExitReason::Breakpoint);
+    EXPECT_EQ(core.registers[rv::zero], 0u);
+}
+
+// CSRRCI has the funct3 111 row to itself, and RV64 has to clear the bits without touching the upper half
+template <typename CoreType>
+void check_csrrci(EmulationType type) {
+    using reg_t = std::remove_cvref_t<decltype(CoreType::registers[0])>;
+    constexpr auto UPPER = static_cast<reg_t>(0xFFFFFFFF00000000ull);
+
+    CoreType core({"Zicsr"}, type);
+    core.csrs[CSR] = UPPER | CSR_VALUE;
+    load_program(core, {rv::csrrci(rv::a0, CSR, 0x15), rv::csrrci(rv::a1, CSR, 0), rv::EBREAK});
+
+    EXPECT_EQ(core.get_backend()->run(3), ExitReason::Breakpoint);
+    ASSERT_FALSE(Risky::is_aborted());
+
+    EXPECT_EQ(core.registers[rv::a0], UPPER | CSR_VALUE);
+    EXPECT_EQ(core.registers[rv::a1], UPPER | (CSR_VALUE & ~0x15u));
+    EXPECT_EQ(core.csrs[CSR], UPPER | (CSR_VALUE & ~0x15u));
+}
+
+TEST(InterpreterDecode, CsrrciClearsImmediateBits) {
+    check_csrrci<RV32I>(EmulationType::Interpreter);
+    check_csrrci<RV32I>(EmulationType::Threaded);
+    check_csrrci<RV64I>(EmulationType::Interpreter);
+    check_csrrci<RV64I>(EmulationType::Threaded);
+}
+
+// Bit 30 picks the arithmetic shift on RV64 too, where SRAI has a six bit shamt and SRAIW works on the low word
+TEST(InterpreterDecode, ArithmeticShiftsRV64) {
+    for (EmulationType type : {EmulationType::Interpreter, EmulationType::Threaded}) {
+        RV64I core({"Zicsr"}, type);
+        core.registers[rv::a1] = 0x8000000080000000ull;
+        load_program(core, {rv::srai(rv::a0, rv::a1, 36), rv::sraiw(rv::a2, rv::a1, 4), rv::EBREAK});
+
+        EXPECT_EQ(core.get_backend()->run(3), ExitReason::Breakpoint);
+        ASSERT_FALSE(Risky::is_aborted());
+        EXPECT_EQ(core.registers[rv::a0], 0xFFFFFFFFF8000000ull);
+        EXPECT_EQ(core.registers[rv::a2], 0xFFFFFFFFF8000000ull);
+    }
+}
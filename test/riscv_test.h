@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cpu/riscv.h>
+#include <cpu/core/backend.h>
+#include <cpu/core/rv32/rv32i.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Instruction encoders, so programs can be written next to the tests that run them
+namespace rv {
+    enum Register : std::uint8_t {
+        zero = 0, ra = 1, sp = 2, gp = 3, tp = 4, t0 = 5, t1 = 6, t2 = 7,
+        s0 = 8, s1 = 9, a0 = 10, a1 = 11, a2 = 12, a3 = 13, a4 = 14, a5 = 15,
+        a6 = 16, a7 = 17, s2 = 18, s3 = 19, s4 = 20, s5 = 21, t3 = 28, t4 = 29
+    };
+
+    constexpr std::uint32_t r_type(std::uint32_t funct7, std::uint32_t rs2, std::uint32_t rs1, std::uint32_t funct3,
+                                   std::uint32_t rd, std::uint32_t opcode) {
+        return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+    }
+
+    constexpr std::uint32_t i_type(std::int32_t imm, std::uint32_t rs1, std::uint32_t funct3, std::uint32_t rd,
+                                   std::uint32_t opcode) {
+        return (static_cast<std::uint32_t>(imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+    }
+
+    constexpr std::uint32_t s_type(std::int32_t imm, std::uint32_t rs2, std::uint32_t rs1, std::uint32_t funct3,
+                                   std::uint32_t opcode) {
+        auto bits = static_cast<std::uint32_t>(imm);
+        return (((bits >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((bits & 0x1F) << 7) | opcode;
+    }
+
+    constexpr std::uint32_t b_type(std::int32_t offset, std::uint32_t rs2, std::uint32_t rs1, std::uint32_t funct3) {
+        auto bits = static_cast<std::uint32_t>(offset);
+        return (((bits >> 12) & 0x1) << 31) | (((bits >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) |
+               (funct3 << 12) | (((bits >> 1) & 0xF) << 8) | (((bits >> 11) & 0x1) << 7) | BRANCH;
+    }
+
+    constexpr std::uint32_t u_type(std::uint32_t imm20, std::uint32_t rd, std::uint32_t opcode) {
+        return (imm20 << 12) | (rd << 7) | opcode;
+    }
+
+    constexpr std::uint32_t j_type(std::int32_t offset, std::uint32_t rd) {
+        auto bits = static_cast<std::uint32_t>(offset);
+        return (((bits >> 20) & 0x1) << 31) | (((bits >> 1) & 0x3FF) << 21) | (((bits >> 11) & 0x1) << 20) |
+               (((bits >> 12) & 0xFF) << 12) | (rd << 7) | JAL;
+    }
+
+    constexpr std::uint32_t lui(std::uint32_t rd, std::uint32_t imm20) { return u_type(imm20, rd, LUI); }
+    constexpr std::uint32_t auipc(std::uint32_t rd, std::uint32_t imm20) { return u_type(imm20, rd, AUIPC); }
+    constexpr std::uint32_t jal(std::uint32_t rd, std::int32_t offset) { return j_type(offset, rd); }
+    constexpr std::uint32_t jalr(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b000, rd, JALR); }
+
+    constexpr std::uint32_t beq(std::uint32_t rs1, std::uint32_t rs2, std::int32_t offset) { return b_type(offset, rs2, rs1, 0b000); }
+    constexpr std::uint32_t bne(std::uint32_t rs1, std::uint32_t rs2, std::int32_t offset) { return b_type(offset, rs2, rs1, 0b001); }
+    constexpr std::uint32_t blt(std::uint32_t rs1, std::uint32_t rs2, std::int32_t offset) { return b_type(offset, rs2, rs1, 0b100); }
+    constexpr std::uint32_t bge(std::uint32_t rs1, std::uint32_t rs2, std::int32_t offset) { return b_type(offset, rs2, rs1, 0b101); }
+    constexpr std::uint32_t bltu(std::uint32_t rs1, std::uint32_t rs2, std::int32_t offset) { return b_type(offset, rs2, rs1, 0b110); }
+    constexpr std::uint32_t bgeu(std::uint32_t rs1, std::uint32_t rs2, std::int32_t offset) { return b_type(offset, rs2, rs1, 0b111); }
+
+    constexpr std::uint32_t lb(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b000, rd, LOAD); }
+    constexpr std::uint32_t lh(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b001, rd, LOAD); }
+    constexpr std::uint32_t lw(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b010, rd, LOAD); }
+    constexpr std::uint32_t lbu(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b100, rd, LOAD); }
+    constexpr std::uint32_t lhu(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b101, rd, LOAD); }
+    constexpr std::uint32_t sb(std::uint32_t rs2, std::uint32_t rs1, std::int32_t imm) { return s_type(imm, rs2, rs1, 0b000, STORE); }
+    constexpr std::uint32_t sh(std::uint32_t rs2, std::uint32_t rs1, std::int32_t imm) { return s_type(imm, rs2, rs1, 0b001, STORE); }
+    constexpr std::uint32_t sw(std::uint32_t rs2, std::uint32_t rs1, std::int32_t imm) { return s_type(imm, rs2, rs1, 0b010, STORE); }
+
+    constexpr std::uint32_t addi(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b000, rd, OPIMM); }
+    constexpr std::uint32_t slli(std::uint32_t rd, std::uint32_t rs1, std::int32_t shamt) { return i_type(shamt, rs1, 0b001, rd, OPIMM); }
+    constexpr std::uint32_t slti(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b010, rd, OPIMM); }
+    constexpr std::uint32_t sltiu(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b011, rd, OPIMM); }
+    constexpr std::uint32_t xori(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b100, rd, OPIMM); }
+    constexpr std::uint32_t srli(std::uint32_t rd, std::uint32_t rs1, std::int32_t shamt) { return i_type(shamt, rs1, 0b101, rd, OPIMM); }
+    constexpr std::uint32_t srai(std::uint32_t rd, std::uint32_t rs1, std::int32_t shamt) { return i_type(0x400 | shamt, rs1, 0b101, rd, OPIMM); }
+    constexpr std::uint32_t sraiw(std::uint32_t rd, std::uint32_t rs1, std::int32_t shamt) { return i_type(0x400 | shamt, rs1, 0b101, rd, OPIMM32); }
+    constexpr std::uint32_t ori(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b110, rd, OPIMM); }
+    constexpr std::uint32_t andi(std::uint32_t rd, std::uint32_t rs1, std::int32_t imm) { return i_type(imm, rs1, 0b111, rd, OPIMM); }
+
+    constexpr std::uint32_t add(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b000, rd, OP); }
+    constexpr std::uint32_t sub(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x20, rs2, rs1, 0b000, rd, OP); }
+    constexpr std::uint32_t sll(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b001, rd, OP); }
+    constexpr std::uint32_t slt(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b010, rd, OP); }
+    constexpr std::uint32_t sltu(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b011, rd, OP); }
+    constexpr std::uint32_t xor_(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b100, rd, OP); }
+    constexpr std::uint32_t srl(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b101, rd, OP); }
+    constexpr std::uint32_t sra(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x20, rs2, rs1, 0b101, rd, OP); }
+    constexpr std::uint32_t or_(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b110, rd, OP); }
+    constexpr std::uint32_t and_(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x00, rs2, rs1, 0b111, rd, OP); }
+    constexpr std::uint32_t mul(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b000, rd, OP); }
+    constexpr std::uint32_t mulh(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b001, rd, OP); }
+    constexpr std::uint32_t mulhsu(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b010, rd, OP); }
+    constexpr std::uint32_t mulhu(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b011, rd, OP); }
+    constexpr std::uint32_t div(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b100, rd, OP); }
+    constexpr std::uint32_t divu(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b101, rd, OP); }
+    constexpr std::uint32_t rem(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b110, rd, OP); }
+    constexpr std::uint32_t remu(std::uint32_t rd, std::uint32_t rs1, std::uint32_t rs2) { return r_type(0x01, rs2, rs1, 0b111, rd, OP); }
+
+    constexpr std::uint32_t csrrw(std::uint32_t rd, std::uint32_t csr, std::uint32_t rs1) { return i_type(csr, rs1, 0b001, rd, SYSTEM); }
+    constexpr std::uint32_t csrrs(std::uint32_t rd, std::uint32_t csr, std::uint32_t rs1) { return i_type(csr, rs1, 0b010, rd, SYSTEM); }
+    constexpr std::uint32_t csrrc(std::uint32_t rd, std::uint32_t csr, std::uint32_t rs1) { return i_type(csr, rs1, 0b011, rd, SYSTEM); }
+    constexpr std::uint32_t csrrwi(std::uint32_t rd, std::uint32_t csr, std::uint32_t uimm) { return i_type(csr, uimm, 0b101, rd, SYSTEM); }
+    constexpr std::uint32_t csrrsi(std::uint32_t rd, std::uint32_t csr, std::uint32_t uimm) { return i_type(csr, uimm, 0b110, rd, SYSTEM); }
+    constexpr std::uint32_t csrrci(std::uint32_t rd, std::uint32_t csr, std::uint32_t uimm) { return i_type(csr, uimm, 0b111, rd, SYSTEM); }
+
+    constexpr std::uint32_t amo_w(std::uint32_t funct5, std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return r_type(funct5 << 2, rs2, rs1, 0b010, rd, AMO); }
+    constexpr std::uint32_t amoadd_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b00000, rd, rs2, rs1); }
+    constexpr std::uint32_t amoswap_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b00001, rd, rs2, rs1); }
+    constexpr std::uint32_t lr_w(std::uint32_t rd, std::uint32_t rs1) { return amo_w(0b00010, rd, 0, rs1); }
+    constexpr std::uint32_t sc_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b00011, rd, rs2, rs1); }
+    constexpr std::uint32_t amoxor_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b00100, rd, rs2, rs1); }
+    constexpr std::uint32_t amoor_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b01000, rd, rs2, rs1); }
+    constexpr std::uint32_t amoand_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b01100, rd, rs2, rs1); }
+    constexpr std::uint32_t amomin_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b10000, rd, rs2, rs1); }
+    constexpr std::uint32_t amomax_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b10100, rd, rs2, rs1); }
+    constexpr std::uint32_t amominu_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b11000, rd, rs2, rs1); }
+    constexpr std::uint32_t amomaxu_w(std::uint32_t rd, std::uint32_t rs2, std::uint32_t rs1) { return amo_w(0b11100, rd, rs2, rs1); }
+
+    constexpr std::uint32_t ECALL = 0x00000073;
+    constexpr std::uint32_t EBREAK = 0x00100073;
+    constexpr std::uint32_t WFI = 0x10500073;
+    constexpr std::uint32_t FENCE = 0x0FF0000F;
+    constexpr std::uint32_t FENCE_I = 0x0000100F;
+}
+
+// Scratch data lives a page above the code, so storing to it never touches a code page
+constexpr std::uint32_t TEST_DATA_BASE = RAM_BASE + CODE_PAGE_SIZE;
+
+// Stores the program at address through the bus, like the guest storing it would
+template <std::uint8_t xlen, bool is_embedded>
+void load_program(RISCV<xlen, is_embedded>& core, const std::vector<std::uint32_t>& program, std::uint32_t address = RAM_BASE) {
+    for (std::uint32_t instruction : program) {
+        core.bus.write32(address, instruction);
+        address += 4;
+    }
+}
+
+// What tests compare between backends, CSRs and memory only hold what capture() was asked for
+struct State {
+    std::array<std::uint32_t, 32> registers;
+    std::uint32_t pc;
+    std::vector<std::uint32_t> csrs;
+    std::vector<std::uint32_t> memory;
+
+    bool operator==(const State&) const = default;
+};
+
+inline State capture(RV32I& core, std::initializer_list<std::uint16_t> csrs = {}, std::uint32_t address = 0, std::uint32_t words = 0) {
+    State state;
+    std::memcpy(state.registers.data(), core.registers, sizeof(core.registers));
+    state.pc = core.pc;
+    for (std::uint16_t csr : csrs) {
+        state.csrs.push_back(core.csrs[csr]);
+    }
+    for (std::uint32_t word = 0; word < words; word++) {
+        state.memory.push_back(core.bus.read32(address + word * 4));
+    }
+    return state;
+}
+
+// An RV32IMA core with Zicsr and Zifencei, the program already stored at RAM_BASE
+inline std::unique_ptr<RV32I> make_core(EmulationType type, const std::vector<std::uint32_t>& program = {}) {
+    auto core = std::make_unique<RV32I>(std::vector<std::string>{"M", "A", "Zicsr", "Zifencei"}, type);
+    load_program(*core, program);
+    return core;
+}
+
+// The block starting at pc in get_compiled_blocks(), null if it isn't compiled
+inline const CompiledBlock* find_block(const std::vector<CompiledBlock>& blocks, std::uint32_t pc) {
+    auto block = std::lower_bound(blocks.begin(), blocks.end(), pc,
+                                  [](const CompiledBlock& block, std::uint32_t pc) { return block.start_pc < pc; });
+    return block != blocks.end() && block->start_pc == pc ? &*block : nullptr;
+}
+
+// The JIT compiles on its workers, so run the program again until the block cache has what
+// the test needs. False if it never got there
+template <typename Run, typename Ready>
+bool run_until_compiled(JITBackend& jit, Run run, Ready ready) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        run();
+
+        if (ready(jit.get_compiled_blocks())) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+}